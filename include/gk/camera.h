@@ -54,6 +54,7 @@ typedef struct GkFrustum {
   vec4              center;
   GkPlane           planes[6]; /* left, right, bottom, top, near, far */
   vec4              corners[8];
+  GkBBox            visibleBounds; /* bounds of visible prims, set by culling */
     
   GkRenderList     *opaque;
   GkRenderList     *transp;
@@ -67,6 +68,7 @@ typedef struct GkCamera {
   mat4           viewProj;
   GkFrustum      frustum;
   GkCameraFlags  flags;
+  uint32_t       hiddenLayers; /* layers which are culled for this camera */
 } GkCamera;
 
 GK_EXPORT
@@ -112,6 +114,15 @@ gkZoomInOneUnit(struct GkScene * __restrict scene);
 void
 gkZoomOutOneUnit(struct GkScene * __restrict scene);
 
+typedef struct GkCullStats {
+  uint64_t planeTests;
+  uint64_t boxesTested;
+  uint64_t nodesVisited;
+  uint64_t nodesInside;   /* accepted with all children                  */
+  uint64_t nodesOutside;
+  uint64_t lastPlaneHits; /* rejected by the plane which rejected before */
+} GkCullStats;
+
 GK_EXPORT
 void
 gkCullFrustum(struct GkScene * __restrict scene,
@@ -127,6 +138,14 @@ void
 gkBoxInFrustum(GkFrustum * __restrict frustum,
                vec3                   box[2]);
 
+GK_EXPORT
+void
+gkCullStats(GkCullStats * __restrict stats);
+
+GK_EXPORT
+void
+gkResetCullStats(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -34,6 +34,7 @@ struct GkContext;
 struct GkSkin;
 struct GkMorph;
 struct GkInstanceMorph;
+struct GkDrawPacket;
 struct FListItem;
 
 typedef void (*gkOnDraw)(struct GkGeometry     * geom,
@@ -83,6 +84,8 @@ typedef struct GkPrimitive {
   GkMaterial          *activeMaterial;
   GkVertexAttachment   vertex;
   GkBBox               bbox; /* local */
+  struct GkMegaAlloc  *mega; /* readonly: range in shared buffers */
+  struct GkOccluderMesh *occMesh; /* readonly: CPU copy for occlusion */
   GLuint               flags;
   GLuint               vao;
   GLsizei              count;
@@ -102,8 +105,11 @@ typedef struct GkPrimInst {
   GkTransform            *trans;
   struct GkGeometryInst  *geomInst;
   GkVertexAttachment     *vertexAttachments;
+  struct GkDrawPacket    *packet;        /* readonly: resolved draw state */
   GkBBox                  bbox;
   uint32_t                maxJoint;
+  uint32_t                vertexVersion; /* bumped when inputs attached   */
+  uint8_t                 cullPlane;     /* last rejecting plane          */
   bool                    hasMorph:1;
   bool                    hasSkin:1;
   bool                    invalidateVertex:1;
@@ -114,6 +120,11 @@ typedef enum GkGeometryFlags {
   GK_GEOM_FLAGS_DRAW_BBOX = 1 << 0,
 } GkGeometryFlags;
 
+typedef enum GkGeometryInstFlags {
+  GK_GEOMINST_FLAGS_NONE     = 0,
+  GK_GEOMINST_FLAGS_OCCLUDER = 1 << 0  /* drawn to CPU occlusion buffer */
+} GkGeometryInstFlags;
+
 typedef struct GkGeometry {
   GkPipeline         *prog;
   GkMaterial         *material;
@@ -144,6 +155,9 @@ typedef struct GkGeometryInst {
   vec3                    center;
   bool                    addedToScene;
   uint64_t                flags;
+  uint32_t                bvhLeaf;  /* readonly: culling tree node   */
+  uint32_t                cullSlot; /* readonly: culling boxes range */
+  uint32_t                layers;   /* readonly: effective node layers */
   int32_t                 primc;
   GkPrimInst              prims[];
 } GkGeometryInst;
@@ -160,6 +174,11 @@ gk_geom_find(struct GkContext * __restrict ctx,
 GkGeometryInst*
 gkMakeInstance(GkGeometry *geom);
 
+/* removes instance from geometry's instance list and frees its resources */
+GK_EXPORT
+void
+gkFreeInstance(GkGeometryInst *inst);
+
 GK_EXPORT
 void
 gkPrimAddBuffer(GkPrimitive * __restrict prim,
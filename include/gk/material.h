@@ -139,6 +139,7 @@ typedef struct GkMaterial {
   GkTechnique   *technique;
   FListItem     *boundTextures;
   float          indexOfRefraction;
+  uint32_t       version; /* see gkInvalidateMaterial() */
   bool           doubleSided;
   uint8_t        isvalid;
   uint8_t        enabled;
@@ -162,6 +163,11 @@ gkMaterialNewMetalRough(void);
 GkSpecGloss*
 gkMaterialNewSpecGloss(void);
 
+/* call after changing technique/inputs, so cached pipelines will be rebuilt */
+GK_EXPORT
+void
+gkInvalidateMaterial(GkMaterial * __restrict mat);
+
 void
 gkUniformMaterial(struct GkContext  * __restrict ctx,
                   struct GkPipeline * __restrict prog,
@@ -41,7 +41,8 @@ typedef enum GkNodeFlags {
   GK_NODEF_NONE           = 0,
   GK_NODEF_NODE           = 1,
   GK_NODEF_HAVE_TRANSFORM = 2,
-  GK_NODEF_JOINT          = 3
+  GK_NODEF_JOINT          = 3,
+  GK_NODEF_TRANSF_DIRTY   = 1 << 3  /* waits for gkFlushTransforms() */
 } GkNodeFlags;
 
 typedef struct GkNode {
@@ -59,6 +60,7 @@ typedef struct GkNode {
   GkInstanceMorph      *morpher;
 
   GkNodeFlags           flags;
+  uint32_t              layers; /* 0: inherit parent's layers, see below */
 } GkNode;
 
 GkNode*
@@ -68,11 +70,59 @@ void
 gkMakeNodeTransform(struct GkScene * __restrict scene,
                     GkNode         * __restrict node);
 
+/*
+ defers gkApplyTransform() until gkFlushTransforms(), which is called once per
+ frame by gkRenderScene(). Many nodes in same subtree are updated once.
+ */
+GK_EXPORT
+void
+gkMarkNodeDirty(struct GkScene * __restrict scene,
+                GkNode         * __restrict node);
+
+GK_EXPORT
+void
+gkFlushTransforms(struct GkScene * __restrict scene);
+
+/*
+ layers of node are inherited by children which don't set their own. Root
+ is in GK_LAYER_DEFAULT. Scene and cameras hide layers by hiddenLayers, so
+ toggling a layer doesn't touch nodes.
+ */
+#define GK_LAYER_DEFAULT (1u << 0)
+#define GK_LAYER_ALL     0xFFFFFFFFu
+
+/* changes layers of subtree, applied in next gkFlushTransforms() */
+GK_EXPORT
+void
+gkSetNodeLayers(struct GkScene * __restrict scene,
+                GkNode         * __restrict node,
+                uint32_t                    layers);
+
+/* effective layers of node */
+GK_EXPORT
+uint32_t
+gkNodeLayers(GkNode * __restrict node);
+
+/* call after nodes are re-parented, flat transform store is rebuilt */
+GK_EXPORT
+void
+gkInvalidateNodeHierarchy(struct GkScene * __restrict scene);
+
 GK_EXPORT
 void
 gkApplyTransform(struct GkScene * __restrict scene,
                  GkNode         * __restrict node);
 
+/*
+ frees node and all of its child nodes: own transforms and geometry
+ instances are released, animations are detached from scene. Node is removed
+ from its parent's child list.
+ */
+GK_EXPORT
+void
+gkFreeNode(struct GkScene * __restrict scene,
+           GkNode         * __restrict node);
+
 GK_EXPORT
 void
 gkApplyView(struct GkScene * __restrict scene,
@@ -0,0 +1,62 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef gk_occlusion_h
+#define gk_occlusion_h
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+
+struct GkScene;
+struct GkCamera;
+
+typedef enum GkOcclusionMode {
+  GK_OCCLUSION_NONE = 0,
+  GK_OCCLUSION_CPU  = 1, /* software depth buffer, occluders are marked  */
+  GK_OCCLUSION_GPU  = 2  /* box queries, previous frame's results are used */
+} GkOcclusionMode;
+
+GK_EXPORT
+void
+gkSetOcclusionMode(struct GkScene * __restrict scene, GkOcclusionMode mode);
+
+GK_EXPORT
+GkOcclusionMode
+gkOcclusionMode(struct GkScene * __restrict scene);
+
+/*
+ runs after gkCullFrustum, marks prims in frustum->opaque which are hidden in
+ this frame. They are kept in the list, they still cast shadows.
+ */
+GK_EXPORT
+void
+gkCullOcclusion(struct GkScene  * __restrict scene,
+                struct GkCamera * __restrict cam);
+
+/* issues queries for next frame after opaque prims are rendered (GPU mode) */
+GK_EXPORT
+void
+gkIssueOcclusionQueries(struct GkScene  * __restrict scene,
+                        struct GkCamera * __restrict cam);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* gk_occlusion_h */
@@ -26,7 +26,16 @@ extern "C" {
 
 typedef enum GkOption {
   GK_OPT_LIGHT_DIR           = 0,  /* 0, 0, -1    */
-  GK_OPT_LIGHT_UP            = 1   /* 0, 1,  0    */
+  GK_OPT_LIGHT_UP            = 1,  /* 0, 1,  0    */
+  GK_OPT_PROG_CACHE_DIR      = 2,  /* NULL: disabled, program binary cache */
+  GK_OPT_SHADER_COMPILE      = 3,  /* GkShaderCompileMode, default: SYNC    */
+  GK_OPT_JOB_WORKERS         = 4,  /* scene update threads, 0: no threads   */
+  GK_OPT_SORT_OPAQUE         = 5,  /* GkSortPolicy, default: STATE          */
+  GK_OPT_SORT_TRANSP         = 6,  /* GkSortPolicy, default: BACK_TO_FRONT  */
+  GK_OPT_INSTANCING          = 7,  /* batch same prim+material, default: 1  */
+  GK_OPT_MULTI_DRAW          = 8,  /* multi draw indirect, default: 0       */
+  GK_OPT_GPU_CULLING         = 9,  /* compute frustum culling, default: 0   */
+  GK_OPT_TRANSFORM_UBO       = 10  /* transforms in ring UBO, default: 1    */
 } GkOption;
 
 GK_EXPORT
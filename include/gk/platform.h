@@ -26,7 +26,13 @@ extern "C" {
 
 /* this caches common queries */
 typedef enum GkPlatformInfo {
-  GK_PLI_MAX_TEX_UNITS = 0
+  GK_PLI_MAX_TEX_UNITS      = 0,
+  GK_PLI_PARALLEL_COMPILE   = 1, /* GL_KHR_parallel_shader_compile     */
+  GK_PLI_CONSERVATIVE_QUERY = 2, /* GL_ANY_SAMPLES_PASSED_CONSERVATIVE */
+  GK_PLI_MULTI_DRAW         = 3, /* glMultiDrawElementsIndirect        */
+  GK_PLI_COMPUTE            = 4, /* compute shaders and SSBOs (GL 4.3) */
+  GK_PLI_BUFFER_STORAGE     = 5, /* persistent mapped buffers          */
+  GK_PLI_UBO_ALIGNMENT      = 6  /* GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT */
 } GkPlatformInfo;
 
 GLint
@@ -29,6 +29,12 @@ gkDrawBBox(struct GkScene * __restrict scene,
            GkBBox                      bbox,
            mat4                        world);
 
+/* solid box with current program, e.g. for occlusion queries */
+void
+gkDrawBBoxFaces(struct GkScene    * __restrict scene,
+                struct GkPipeline * __restrict prog,
+                GkBBox                         bbox);
+
 void
 gkInitCube(void);
 
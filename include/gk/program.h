@@ -39,6 +39,14 @@ struct GkLight;
 struct GkShader;
 struct GkScene;
 struct GkContext;
+struct GkPipelineBuild;
+
+/* GK_OPT_SHADER_COMPILE */
+typedef enum GkShaderCompileMode {
+  GK_SHADER_COMPILE_SYNC           = 0, /* compile, link and wait         */
+  GK_SHADER_COMPILE_ASYNC_SKIP     = 1, /* skip draws until it is ready   */
+  GK_SHADER_COMPILE_ASYNC_FALLBACK = 2  /* use fallback until it is ready */
+} GkShaderCompileMode;
 
 typedef struct GkPipeline {
   FListItem         *vertex;
@@ -46,6 +54,7 @@ typedef struct GkPipeline {
   struct GkShader   *shaders;
   struct GkMaterial *lastMaterial;
   struct GkLight    *lastLight;
+  struct GkPipelineBuild *build; /* not NULL while compiling/linking */
   uint32_t           refc;
   GLint              progId;
   GLint              mvpi;
@@ -63,6 +72,7 @@ typedef struct GkPipeline {
   GLint              fari;
   bool               updtLights;
   bool               updtMaterials;
+  bool               drawBlock;     /* transforms are read from DrawBlock */
 } GkPipeline;
 
 void
@@ -79,6 +89,21 @@ gkNewPipeline(GkShader *shaders,
               void    (*beforeLink)(GkPipeline *prog, void *data),
               void     *userData);
 
+/* issues compile/link but doesn't wait, see gkPipelineIsReady(). key: binary
+   cache key, must be stable across runs; 0: not cached */
+GkPipeline*
+gkNewPipelineAsync(GkShader *shaders,
+                   void    (*beforeLink)(GkPipeline *prog, void *data),
+                   void     *userData,
+                   uint64_t  key);
+
+bool
+gkPipelineIsReady(GkPipeline * __restrict prog);
+
+/* blocks until async build is finished, returns false if it is failed */
+bool
+gkPipelineWait(GkPipeline * __restrict prog);
+
 GkPipeline*
 gkDefaultProgram(void);
 
@@ -95,6 +120,29 @@ gkGetPipeline(char       *name,
               GkPipeline *(creatCb)(char *name, void *userData),
               void       *userData);
 
+typedef struct GkProgramCacheStats {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t stores;
+  uint32_t rejected;    /* stale or invalid binaries          */
+  double   compileTime; /* seconds spent to compile and link  */
+  double   loadTime;    /* seconds spent to load binaries     */
+} GkProgramCacheStats;
+
+/* program binary cache is enabled by setting GK_OPT_PROG_CACHE_DIR */
+GK_EXPORT
+void
+gkProgramCacheStats(GkProgramCacheStats * __restrict stats);
+
+GK_EXPORT
+void
+gkResetProgramCacheStats(void);
+
+GkPipeline*
+gkGetPipelineByKey(uint64_t    key,
+                   GkPipeline *(creatCb)(uint64_t key, void *userData),
+                   void       *userData);
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,6 +26,14 @@ extern "C" {
 
 struct GkLight;
 
+/* draw order of render lists, see GK_OPT_SORT_OPAQUE, GK_OPT_SORT_TRANSP */
+typedef enum GkSortPolicy {
+  GK_SORT_NONE          = 0, /* keep culling order                     */
+  GK_SORT_STATE         = 1, /* pipeline, material, vao then depth     */
+  GK_SORT_FRONT_TO_BACK = 2, /* depth first, then state                */
+  GK_SORT_BACK_TO_FRONT = 3  /* far ones first, for blended transparency */
+} GkSortPolicy;
+
 void
 gkPrepMaterial(GkScene     *scene,
                GkGeometryInst *modelInst);
@@ -56,6 +64,14 @@ gkRenderNode(GkScene     *scene,
 void
 gkRenderScene(GkScene * scene);
 
+/* sorts items of list in place by 64-bit keys, sub-frustums keep the order */
+GK_EXPORT
+void
+gkSortRenderList(GkScene      * __restrict scene,
+                 GkCamera     * __restrict cam,
+                 GkRenderList * __restrict rnlist,
+                 GkSortPolicy              policy);
+
 GK_EXPORT
 void
 gkRenderShadows(GkScene * __restrict scene,
@@ -43,20 +43,21 @@ typedef void (*GkRenderPrimFunc)(struct GkScene    *scene,
 typedef void (*GkRenderAfterClearFunc)(struct GkScene *scene, void * __restrict obj);
 
 typedef enum GkSceneFlags {
-  GK_SCENEF_NONE           = 0,
-  GK_SCENEF_DRAW_BBOX      = 1 << 0,
-  GK_SCENEF_UPDT_LIGHTS    = 1 << 3,
-  GK_SCENEF_ONCE           = 1 << 4,
-  GK_SCENEF_RENDERING      = 1 << 5,
-  GK_SCENEF_RENDERED       = 1 << 6,
-  GK_SCENEF_RENDER         = 1 << 7,
-  GK_SCENEF_NEEDS_RENDER   = GK_SCENEF_RENDER | GK_SCENEF_UPDT_LIGHTS,
-  GK_SCENEF_INIT           = GK_SCENEF_NEEDS_RENDER,
-  GK_SCENEF_TRANSP         = 1 << 8,
-  GK_SCENEF_SHADOWS        = 1 << 9,
-  GK_SCENEF_PREPARED       = 1 << 10,
-  GK_SCENEF_DRAW_PRIM_BBOX = 1 << 11,
-  GK_SCENEF_DRAW_BONES     = 1 << 12
+  GK_SCENEF_NONE            = 0,
+  GK_SCENEF_DRAW_BBOX       = 1 << 0,
+  GK_SCENEF_UPDT_LIGHTS     = 1 << 3,
+  GK_SCENEF_ONCE            = 1 << 4,
+  GK_SCENEF_RENDERING       = 1 << 5,
+  GK_SCENEF_RENDERED        = 1 << 6,
+  GK_SCENEF_RENDER          = 1 << 7,
+  GK_SCENEF_NEEDS_RENDER    = GK_SCENEF_RENDER | GK_SCENEF_UPDT_LIGHTS,
+  GK_SCENEF_INIT            = GK_SCENEF_NEEDS_RENDER,
+  GK_SCENEF_TRANSP          = 1 << 8,
+  GK_SCENEF_SHADOWS         = 1 << 9,
+  GK_SCENEF_PREPARED        = 1 << 10,
+  GK_SCENEF_DRAW_PRIM_BBOX  = 1 << 11,
+  GK_SCENEF_DRAW_BONES      = 1 << 12,
+  GK_SCENEF_FLAT_TRANSFORMS = 1 << 13  /* update transforms in flat store */
 } GkSceneFlags;
 
 GK_MAKE_C_ENUM(GkSceneFlags)
@@ -79,6 +80,7 @@ typedef struct GkScene {
   uint32_t           lightCount;
   uint32_t           lastLightIndex;
   GkSceneFlags       flags;
+  uint32_t           hiddenLayers; /* hidden for all cameras */
   int32_t            internalFormat;
   float              backingScale;
   float              fpsApprx;
@@ -109,6 +111,38 @@ gkContextOf(GkScene * __restrict scene) {
   return scene->ctx;
 }
 
+typedef struct GkShaderVariantInfo {
+  uint64_t key;
+  double   time;   /* seconds to create, includes waiting for async builds */
+  bool     cached; /* loaded from program binary cache                     */
+  bool     failed;
+} GkShaderVariantInfo;
+
+typedef struct GkShaderWarmupReport {
+  GkShaderVariantInfo *variants;
+  uint32_t             count;    /* variants are needed by scene          */
+  uint32_t             created;  /* compiled or loaded by warm-up         */
+  uint32_t             cached;
+  uint32_t             failed;
+  double               totalTime;
+} GkShaderWarmupReport;
+
+/*
+ creates all shader variants which are needed to render scene with current
+ lights, shadow and transparency settings. If parallel is true then variants
+ are compiled in a batch without waiting each one. report is optional, call
+ gkFreeWarmupReport() to release it.
+ */
+GK_EXPORT
+void
+gkWarmupShaders(GkScene              * __restrict scene,
+                bool                              parallel,
+                GkShaderWarmupReport * __restrict report);
+
+GK_EXPORT
+void
+gkFreeWarmupReport(GkShaderWarmupReport * __restrict report);
+
 GK_EXPORT
 void
 gkEnableShadows(GkScene * __restrict scene);
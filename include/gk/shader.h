@@ -51,6 +51,16 @@ gkShaderLoadN(GLenum  shaderType,
               char   *source[],
               size_t  count);
 
+/* compile without waiting and checking compile status */
+GLuint
+gkShaderCompile(GLenum shaderType,
+                const char * __restrict source);
+
+GLuint
+gkShaderCompileN(GLenum  shaderType,
+                 char   *source[],
+                 size_t  count);
+
 void
 gkAttachShaders(GLuint program,
                 GkShader * __restrict shaders);
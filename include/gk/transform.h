@@ -57,13 +57,15 @@ typedef struct GkTransformItem {
   struct GkTransformItem *prev;
   struct GkTransformItem *next;
   GkTransformType         type;
+  bool                    animated; /* an animation channel writes to this */
 } GkTransformItem;
 
 /* some geometries or nodes may not have matrix,
- so they will use parent's one. */
+ so they will use parent's one. local and world point to matrices (mat4) of
+ transform or to rows of scene's flat transform store, never cache them. */
 typedef struct GkTransform {
-  mat4              local;  /* cached local transform as matrix         */
-  mat4              world;  /* cached world transform as matrix         */
+  vec4             *local;  /* cached local transform as matrix         */
+  vec4             *world;  /* cached world transform as matrix         */
   GkTransformFlags  flags;
   GkTransformItem  *item;   /* individual transforms                    */
 } GkTransform;
@@ -100,6 +102,8 @@ typedef struct GkQuaternion {
   versor          value;
 } GkQuaternion;
 
+/* COLLADA / RenderMan skew, rotateAxis is rotated by angle (radians) toward
+   aroundAxis, points are moved along aroundAxis */
 typedef struct GkSkew {
   GkTransformItem base;
   float           angle;
@@ -111,9 +115,28 @@ GK_EXPORT
 GkTransform*
 gkAllocTransform(struct GkScene * __restrict scene);
 
+/* frees transform and its items, transform must not be used anymore */
+GK_EXPORT
+void
+gkFreeTransform(struct GkScene * __restrict scene,
+                GkTransform    * __restrict trans);
+
 void
 gkTransformCombine(GkTransform * __restrict trans);
 
+/*
+ items are compiled at first combine: runs of non-animated items are folded
+ into cached matrices. Call this after adding, removing or editing items
+ outside of animations.
+ */
+GK_EXPORT
+void
+gkTransformItemsChanged(GkTransform * __restrict trans);
+
+/* marks item which owns target memory as animated */
+void
+gkTransformMarkAnimated(GkTransform * __restrict trans, void *target);
+
 GkPoint
 gk_project2d(GkRect rect, mat4 mvp, vec3 v);
 
@@ -30,3 +30,17 @@ gkAddAnimation(GkScene     *scene,
 
   flist_sp_insert(&sceneImpl->anims, anim);
 }
+
+GK_EXPORT
+void
+gkRemoveAnimation(GkNode *node, GkAnimation *anim) {
+  GkSceneImpl *sceneImpl;
+
+  if (node && node->anim)
+    flist_remove_by(node->anim->animations, anim);
+
+  if ((sceneImpl = (GkSceneImpl *)anim->scene))
+    flist_sp_remove_by(&sceneImpl->anims, anim);
+
+  anim->node = NULL;
+}
@@ -37,7 +37,7 @@ gkBuiltinRotationAnim(GkAnimation *anim,
                 delta->val.floatValue,
                 data[1]);
 
-  gkApplyTransform(anim->scene, node);
+  gkMarkNodeDirty(anim->scene, node);
 
   return false;
 }
@@ -61,7 +61,7 @@ gkBuiltinTranslateAnim(GkAnimation *anim,
 
   node = anim->node;
   glm_translate(node->trans->local, delta->val.p);
-  gkApplyTransform(anim->scene, node);
+  gkMarkNodeDirty(anim->scene, node);
 
   return false;
 }
@@ -76,7 +76,7 @@ gkBuiltinScaleAnim(GkAnimation *anim,
 
   node = anim->node;
   glm_scale_make(node->trans->local, to->val.p);
-  gkApplyTransform(anim->scene, node);
+  gkMarkNodeDirty(anim->scene, node);
 
   return false;
 }
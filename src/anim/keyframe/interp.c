@@ -104,6 +104,6 @@ gkInterpolateChannel(GkAnimation * __restrict anim,
     if (ch->isLocalTransform && ch->node->trans)
       ch->node->trans->flags &= ~GK_TRANSF_LOCAL_ISVALID;
   
-    gkApplyTransform(anim->scene, ch->node);
+    gkMarkNodeDirty(anim->scene, ch->node);
   }
 }
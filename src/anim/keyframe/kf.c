@@ -64,6 +64,10 @@ gkPrepChannel(GkAnimation *anim, GkChannel *ch) {
 
     ch->ov[isReverse]  = target;
     ch->ov[!isReverse] = data + (outp->count - 1) * stride;
+
+    /* keep animated item out of folded static matrices */
+    if (ch->isLocalTransform && ch->node && ch->node->trans)
+      gkTransformMarkAnimated(ch->node->trans, target);
   }
 
   /* fix 1D tangents */
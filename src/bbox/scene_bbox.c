@@ -4,9 +4,15 @@
  */
 
 #include "scene_bbox.h"
+#include "../types/impl_scene.h"
 
 GK_EXPORT
 void
 gkUpdateSceneAABB(GkScene * __restrict scene, GkBBox bbox) {
   glm_aabb_merge(scene->bbox, bbox, scene->bbox);
 }
+
+void
+gkUpdateSceneBounds(GkScene * __restrict scene) {
+  gkBVHBounds(&((GkSceneImpl *)scene)->bvh, scene->bbox, scene->center);
+}
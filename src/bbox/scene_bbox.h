@@ -12,4 +12,8 @@ GK_EXPORT
 void
 gkUpdateSceneAABB(GkScene * __restrict scene, GkBBox bbox);
 
+/* copies bounds and center which are kept in root of scene's BVH */
+void
+gkUpdateSceneBounds(GkScene * __restrict scene);
+
 #endif /* src_scene_bbox_h */
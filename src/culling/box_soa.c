@@ -0,0 +1,300 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../common.h"
+#include "box_soa.h"
+
+#include <string.h>
+
+#if defined(GK_CULL_AVX)
+#  include <immintrin.h>
+#elif defined(GK_CULL_SSE)
+#  include <emmintrin.h>
+#elif defined(GK_CULL_NEON)
+#  include <arm_neon.h>
+#endif
+
+static
+GK_INLINE
+void
+gk__boxSoASet(GkBoxSoA * __restrict soa, uint32_t i, vec3 box[2]) {
+  soa->v[GK_BOX_MINX][i] = box[0][0];
+  soa->v[GK_BOX_MINY][i] = box[0][1];
+  soa->v[GK_BOX_MINZ][i] = box[0][2];
+  soa->v[GK_BOX_MAXX][i] = box[1][0];
+  soa->v[GK_BOX_MAXY][i] = box[1][1];
+  soa->v[GK_BOX_MAXZ][i] = box[1][2];
+}
+
+static
+GK_INLINE
+void
+gk__boxSoADirty(GkBoxSoA * __restrict soa, uint32_t start, uint32_t end) {
+  if (soa->dirtyEnd <= soa->dirtyStart) {
+    soa->dirtyStart = start;
+    soa->dirtyEnd   = end;
+    return;
+  }
+
+  if (start < soa->dirtyStart)
+    soa->dirtyStart = start;
+
+  if (end > soa->dirtyEnd)
+    soa->dirtyEnd = end;
+}
+
+/* first fit, remaining part of range stays free */
+static
+uint32_t
+gk__boxSoAReuse(GkBoxSoA * __restrict soa, uint32_t count) {
+  GkBoxRange *r;
+  uint32_t    i, start;
+
+  for (i = 0; i < soa->freeCount; i++) {
+    r = &soa->freeRanges[i];
+    if (r->count < count)
+      continue;
+
+    start     = r->start;
+    r->start += count;
+    r->count -= count;
+
+    if (r->count == 0)
+      soa->freeRanges[i] = soa->freeRanges[--soa->freeCount];
+
+    return start;
+  }
+
+  return 0;
+}
+
+void
+gkBoxSoAUpdate(GkBoxSoA       * __restrict soa,
+               GkGeometryInst * __restrict geomInst) {
+  uint32_t slot, need, i;
+  int32_t  j;
+
+  if ((slot = geomInst->cullSlot) == 0
+      && (slot = gk__boxSoAReuse(soa, geomInst->primc + 1)) != 0) {
+    geomInst->cullSlot = slot;
+    soa->version++;
+  }
+
+  if (slot == 0) {
+    if (soa->count == 0)
+      soa->count = 1;
+
+    need = soa->count + geomInst->primc + 1;
+    if (need > soa->size) {
+      soa->size = soa->size ? soa->size * 2 : 1024;
+      if (soa->size < need)
+        soa->size = need;
+
+      for (i = 0; i < 6; i++)
+        soa->v[i] = realloc(soa->v[i], soa->size * sizeof(float));
+    }
+
+    slot               = soa->count;
+    soa->count         = need;
+    geomInst->cullSlot = slot;
+    soa->version++;
+  }
+
+  gk__boxSoADirty(soa, slot, slot + geomInst->primc + 1);
+
+  gk__boxSoASet(soa, slot, geomInst->bbox);
+  for (j = 0; j < geomInst->primc; j++)
+    gk__boxSoASet(soa, slot + 1 + j, geomInst->prims[j].bbox);
+}
+
+void
+gkBoxSoARemove(GkBoxSoA       * __restrict soa,
+               GkGeometryInst * __restrict geomInst) {
+  GkBoxRange *r;
+
+  if (geomInst->cullSlot == 0)
+    return;
+
+  if (soa->freeCount == soa->freeSize) {
+    soa->freeSize   = soa->freeSize ? soa->freeSize * 2 : 16;
+    soa->freeRanges = realloc(soa->freeRanges,
+                              soa->freeSize * sizeof(*soa->freeRanges));
+  }
+
+  r        = &soa->freeRanges[soa->freeCount++];
+  r->start = geomInst->cullSlot;
+  r->count = geomInst->primc + 1;
+
+  geomInst->cullSlot = 0;
+  soa->version++;
+}
+
+void
+gkBoxSoADestroy(GkBoxSoA * __restrict soa) {
+  uint32_t i;
+
+  for (i = 0; i < 6; i++)
+    free(soa->v[i]);
+
+  free(soa->freeRanges);
+
+  memset(soa, 0, sizeof(*soa));
+}
+
+/*
+ for each plane: a * (a > 0 ? max : min) is max(a * min, a * max), so the
+ farthest corner along plane normal needs no branch or select.
+ */
+static
+GK_INLINE
+bool
+gk__cullBoxScalar(float ** __restrict v,
+                  uint32_t            i,
+                  vec4                planes[6],
+                  uint32_t            planeMask) {
+  float  *p, d;
+  int32_t k;
+
+  for (k = 0; k < 6; k++) {
+    if (!(planeMask & (1u << k)))
+      continue;
+
+    p = planes[k];
+    d = glm_max(p[0] * v[GK_BOX_MINX][i], p[0] * v[GK_BOX_MAXX][i])
+      + glm_max(p[1] * v[GK_BOX_MINY][i], p[1] * v[GK_BOX_MAXY][i])
+      + glm_max(p[2] * v[GK_BOX_MINZ][i], p[2] * v[GK_BOX_MAXZ][i]);
+
+    if (d < -p[3])
+      return false;
+  }
+
+  return true;
+}
+
+void
+gkCullBoxes(GkBoxSoA * __restrict soa,
+            uint32_t              start,
+            uint32_t              count,
+            vec4                  planes[6],
+            uint32_t              planeMask,
+            uint32_t * __restrict mask) {
+  float   **v;
+  uint32_t  i, end;
+
+  v   = soa->v;
+  end = start + count;
+  i   = start;
+
+  memset(mask, 0, ((count + 31) / 32) * sizeof(*mask));
+
+#if defined(GK_CULL_AVX)
+  for (; i + 8 <= end; i += 8) {
+    __m256   vis, d, a, nw;
+    uint32_t bits;
+    int32_t  k;
+
+    vis = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (k = 0; k < 6; k++) {
+      if (!(planeMask & (1u << k)))
+        continue;
+
+      a  = _mm256_set1_ps(planes[k][0]);
+      d  = _mm256_max_ps(_mm256_mul_ps(a, _mm256_loadu_ps(v[GK_BOX_MINX] + i)),
+                         _mm256_mul_ps(a, _mm256_loadu_ps(v[GK_BOX_MAXX] + i)));
+      a  = _mm256_set1_ps(planes[k][1]);
+      d  = _mm256_add_ps(d,
+             _mm256_max_ps(_mm256_mul_ps(a, _mm256_loadu_ps(v[GK_BOX_MINY] + i)),
+                           _mm256_mul_ps(a, _mm256_loadu_ps(v[GK_BOX_MAXY] + i))));
+      a  = _mm256_set1_ps(planes[k][2]);
+      d  = _mm256_add_ps(d,
+             _mm256_max_ps(_mm256_mul_ps(a, _mm256_loadu_ps(v[GK_BOX_MINZ] + i)),
+                           _mm256_mul_ps(a, _mm256_loadu_ps(v[GK_BOX_MAXZ] + i))));
+      nw  = _mm256_set1_ps(-planes[k][3]);
+      vis = _mm256_and_ps(vis, _mm256_cmp_ps(d, nw, _CMP_GE_OQ));
+    }
+
+    bits = (uint32_t)_mm256_movemask_ps(vis);
+    mask[(i - start) >> 5] |= bits << ((i - start) & 31);
+  }
+#elif defined(GK_CULL_SSE)
+  for (; i + 4 <= end; i += 4) {
+    __m128   vis, d, a, nw;
+    uint32_t bits;
+    int32_t  k;
+
+    vis = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (k = 0; k < 6; k++) {
+      if (!(planeMask & (1u << k)))
+        continue;
+
+      a  = _mm_set1_ps(planes[k][0]);
+      d  = _mm_max_ps(_mm_mul_ps(a, _mm_loadu_ps(v[GK_BOX_MINX] + i)),
+                      _mm_mul_ps(a, _mm_loadu_ps(v[GK_BOX_MAXX] + i)));
+      a  = _mm_set1_ps(planes[k][1]);
+      d  = _mm_add_ps(d,
+             _mm_max_ps(_mm_mul_ps(a, _mm_loadu_ps(v[GK_BOX_MINY] + i)),
+                        _mm_mul_ps(a, _mm_loadu_ps(v[GK_BOX_MAXY] + i))));
+      a  = _mm_set1_ps(planes[k][2]);
+      d  = _mm_add_ps(d,
+             _mm_max_ps(_mm_mul_ps(a, _mm_loadu_ps(v[GK_BOX_MINZ] + i)),
+                        _mm_mul_ps(a, _mm_loadu_ps(v[GK_BOX_MAXZ] + i))));
+      nw  = _mm_set1_ps(-planes[k][3]);
+      vis = _mm_and_ps(vis, _mm_cmpge_ps(d, nw));
+    }
+
+    bits = (uint32_t)_mm_movemask_ps(vis);
+    mask[(i - start) >> 5] |= bits << ((i - start) & 31);
+  }
+#elif defined(GK_CULL_NEON)
+  for (; i + 4 <= end; i += 4) {
+    static const uint32_t lanes[4] = {1, 2, 4, 8};
+    uint32x4_t  vis;
+    float32x4_t d, a;
+    uint32_t    bits;
+    int32_t     k;
+
+    vis = vdupq_n_u32(0xFFFFFFFF);
+    for (k = 0; k < 6; k++) {
+      if (!(planeMask & (1u << k)))
+        continue;
+
+      a   = vdupq_n_f32(planes[k][0]);
+      d   = vmaxq_f32(vmulq_f32(a, vld1q_f32(v[GK_BOX_MINX] + i)),
+                      vmulq_f32(a, vld1q_f32(v[GK_BOX_MAXX] + i)));
+      a   = vdupq_n_f32(planes[k][1]);
+      d   = vaddq_f32(d, vmaxq_f32(vmulq_f32(a, vld1q_f32(v[GK_BOX_MINY] + i)),
+                                   vmulq_f32(a, vld1q_f32(v[GK_BOX_MAXY] + i))));
+      a   = vdupq_n_f32(planes[k][2]);
+      d   = vaddq_f32(d, vmaxq_f32(vmulq_f32(a, vld1q_f32(v[GK_BOX_MINZ] + i)),
+                                   vmulq_f32(a, vld1q_f32(v[GK_BOX_MAXZ] + i))));
+      vis = vandq_u32(vis, vcgeq_f32(d, vdupq_n_f32(-planes[k][3])));
+    }
+
+    vis  = vandq_u32(vis, vld1q_u32(lanes));
+    bits = vgetq_lane_u32(vis, 0) | vgetq_lane_u32(vis, 1)
+         | vgetq_lane_u32(vis, 2) | vgetq_lane_u32(vis, 3);
+    mask[(i - start) >> 5] |= bits << ((i - start) & 31);
+  }
+#endif
+
+  /* tail or scalar fallback */
+  for (; i < end; i++) {
+    if (gk__cullBoxScalar(v, i, planes, planeMask))
+      mask[(i - start) >> 5] |= 1u << ((i - start) & 31);
+  }
+}
@@ -0,0 +1,94 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef box_soa_h
+#define box_soa_h
+
+#include "../../include/gk/gk.h"
+
+/* define GK_CULL_SCALAR to disable SIMD culling kernel */
+#if !defined(GK_CULL_SCALAR)
+#  if defined(__AVX__)
+#    define GK_CULL_AVX
+#  elif defined(__SSE2__) || defined(_M_X64) || (_M_IX86_FP >= 2)
+#    define GK_CULL_SSE
+#  elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#    define GK_CULL_NEON
+#  endif
+#endif
+
+enum {
+  GK_BOX_MINX = 0,
+  GK_BOX_MINY = 1,
+  GK_BOX_MINZ = 2,
+  GK_BOX_MAXX = 3,
+  GK_BOX_MAXY = 4,
+  GK_BOX_MAXZ = 5
+};
+
+/*
+ world boxes in structure of arrays to test many boxes at once. Each geometry
+ instance owns a range: its own box then its primitives' boxes. Slot 0 is
+ reserved so zero means no range.
+ */
+typedef struct GkBoxRange {
+  uint32_t start;
+  uint32_t count;
+} GkBoxRange;
+
+typedef struct GkBoxSoA {
+  float      *v[6];
+  GkBoxRange *freeRanges; /* ranges of removed instances, reused first */
+  uint32_t    count;
+  uint32_t    size;
+  uint32_t    freeCount;
+  uint32_t    freeSize;
+  uint32_t    dirtyStart; /* boxes changed since last gkBoxSoAClean() */
+  uint32_t    dirtyEnd;
+  uint32_t    version;    /* bumped when ranges are added or removed   */
+} GkBoxSoA;
+
+void
+gkBoxSoAUpdate(GkBoxSoA * __restrict soa, GkGeometryInst * __restrict geomInst);
+
+void
+gkBoxSoARemove(GkBoxSoA * __restrict soa, GkGeometryInst * __restrict geomInst);
+
+void
+gkBoxSoADestroy(GkBoxSoA * __restrict soa);
+
+/* resets changed range, for GPU copies of boxes */
+GK_INLINE
+void
+gkBoxSoAClean(GkBoxSoA * __restrict soa) {
+  soa->dirtyStart = soa->dirtyEnd = 0;
+}
+
+/*
+ sets bit i of mask if box (start + i) is in or intersects planes, only planes
+ in planeMask are tested.
+ */
+void
+gkCullBoxes(GkBoxSoA * __restrict soa,
+            uint32_t              start,
+            uint32_t              count,
+            vec4                  planes[6],
+            uint32_t              planeMask,
+            uint32_t * __restrict mask);
+
+#endif /* box_soa_h */
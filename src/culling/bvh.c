@@ -0,0 +1,398 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../common.h"
+#include "bvh.h"
+
+#include <string.h>
+
+/*
+ dynamic AABB tree ref:
+   Erin Catto, Dynamic Bounding Volume Hierarchies, GDC 2019
+   box2d b2DynamicTree
+ */
+
+#define GK_BVH_MAX(a, b) ((a) > (b) ? (a) : (b))
+
+static
+GK_INLINE
+float
+gk__bvhArea(vec3 box[2]) {
+  vec3 d;
+
+  glm_vec3_sub(box[1], box[0], d);
+  return 2.0f * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+}
+
+static
+GK_INLINE
+float
+gk__bvhMergedArea(vec3 a[2], vec3 b[2]) {
+  vec3 t[2];
+
+  glm_aabb_merge(a, b, t);
+  return gk__bvhArea(t);
+}
+
+static
+GK_INLINE
+bool
+gk__bvhContains(vec3 a[2], vec3 b[2]) {
+  return a[0][0] <= b[0][0] && a[0][1] <= b[0][1] && a[0][2] <= b[0][2]
+      && a[1][0] >= b[1][0] && a[1][1] >= b[1][1] && a[1][2] >= b[1][2];
+}
+
+static
+_gk_hide
+uint32_t
+gk__bvhAlloc(GkBVH * __restrict bvh) {
+  GkBVHNode *node;
+  uint32_t   idx;
+
+  if ((idx = bvh->freeNode) != GK_BVH_NULL) {
+    bvh->freeNode = bvh->nodes[idx].parent;
+  } else {
+    if (bvh->count == 0)
+      bvh->count = 1; /* skip null node */
+
+    if (bvh->count == bvh->size) {
+      bvh->size  = bvh->size ? bvh->size * 2 : 64;
+      bvh->nodes = realloc(bvh->nodes, bvh->size * sizeof(*bvh->nodes));
+    }
+
+    idx = bvh->count++;
+  }
+
+  node = &bvh->nodes[idx];
+  memset(node, 0, sizeof(*node));
+
+  return idx;
+}
+
+static
+_gk_hide
+void
+gk__bvhFree(GkBVH * __restrict bvh, uint32_t idx) {
+  bvh->nodes[idx].parent = bvh->freeNode;
+  bvh->nodes[idx].height = -1;
+  bvh->freeNode          = idx;
+}
+
+static
+_gk_hide
+void
+gk__bvhRefit(GkBVH * __restrict bvh, uint32_t idx) {
+  GkBVHNode *nodes, *node, *c0, *c1;
+
+  nodes = bvh->nodes;
+  node  = &nodes[idx];
+  c0    = &nodes[node->child[0]];
+  c1    = &nodes[node->child[1]];
+
+  glm_aabb_merge(c0->box, c1->box, node->box);
+  glm_aabb_merge(c0->tight, c1->tight, node->tight);
+  glm_vec3_add(c0->centerSum, c1->centerSum, node->centerSum);
+  node->instCount = c0->instCount + c1->instCount;
+  node->layers    = c0->layers | c1->layers;
+  node->height    = 1 + GK_BVH_MAX(c0->height, c1->height);
+}
+
+/* fat boxes are still valid, only exact bounds and layers of ancestors are
+   updated */
+static
+_gk_hide
+void
+gk__bvhRefitBounds(GkBVH * __restrict bvh, uint32_t idx) {
+  GkBVHNode *nodes, *node, *c0, *c1;
+
+  nodes = bvh->nodes;
+
+  while (idx != GK_BVH_NULL) {
+    node = &nodes[idx];
+    c0   = &nodes[node->child[0]];
+    c1   = &nodes[node->child[1]];
+
+    glm_aabb_merge(c0->tight, c1->tight, node->tight);
+    glm_vec3_add(c0->centerSum, c1->centerSum, node->centerSum);
+    node->layers = c0->layers | c1->layers;
+
+    idx = node->parent;
+  }
+}
+
+/* AVL like rotation, keeps tree balanced when objects are inserted in order */
+static
+_gk_hide
+uint32_t
+gk__bvhBalance(GkBVH * __restrict bvh, uint32_t iA) {
+  GkBVHNode *nodes, *A, *B, *C, *F, *G;
+  uint32_t   iB, iC, iF, iG, iP, i;
+  int32_t    balance, up;
+
+  nodes = bvh->nodes;
+  A     = &nodes[iA];
+
+  if (A->child[0] == GK_BVH_NULL || A->height < 2)
+    return iA;
+
+  iB      = A->child[0];
+  iC      = A->child[1];
+  B       = &nodes[iB];
+  C       = &nodes[iC];
+  balance = C->height - B->height;
+
+  if (balance > 1)
+    up = 1;
+  else if (balance < -1)
+    up = 0;
+  else
+    return iA;
+
+  /* rotate the higher child up: C up if up == 1, B otherwise */
+  if (up == 0) {
+    iC = iB;
+    C  = B;
+    iB = A->child[1];
+    B  = &nodes[iB];
+  }
+
+  iF = C->child[0];
+  iG = C->child[1];
+  F  = &nodes[iF];
+  G  = &nodes[iG];
+
+  iP = A->parent;
+
+  C->child[0] = iA;
+  C->parent   = iP;
+  A->parent   = iC;
+
+  if (iP != GK_BVH_NULL) {
+    i = nodes[iP].child[0] == iA ? 0 : 1;
+    nodes[iP].child[i] = iC;
+  } else {
+    bvh->root = iC;
+  }
+
+  /* keep higher grandchild under C, the other one goes under A */
+  if (F->height > G->height) {
+    C->child[1] = iF;
+    A->child[up] = iG;
+    G->parent   = iA;
+  } else {
+    C->child[1] = iG;
+    A->child[up] = iF;
+    F->parent   = iA;
+  }
+
+  gk__bvhRefit(bvh, iA);
+  gk__bvhRefit(bvh, iC);
+
+  return iC;
+}
+
+static
+_gk_hide
+void
+gk__bvhRefitUp(GkBVH * __restrict bvh, uint32_t idx) {
+  while (idx != GK_BVH_NULL) {
+    idx = gk__bvhBalance(bvh, idx);
+    gk__bvhRefit(bvh, idx);
+    idx = bvh->nodes[idx].parent;
+  }
+}
+
+static
+_gk_hide
+void
+gk__bvhInsertLeaf(GkBVH * __restrict bvh, uint32_t leaf) {
+  GkBVHNode *nodes;
+  vec3      *box;
+  uint32_t   idx, sibling, oldParent, newParent, c0, c1;
+  float      area, combined, cost, inherit, cost0, cost1;
+
+  if (bvh->root == GK_BVH_NULL) {
+    bvh->root                = leaf;
+    bvh->nodes[leaf].parent  = GK_BVH_NULL;
+    return;
+  }
+
+  /* find best sibling by surface area heuristic */
+  nodes = bvh->nodes;
+  box   = nodes[leaf].box;
+  idx   = bvh->root;
+
+  while (nodes[idx].child[0] != GK_BVH_NULL) {
+    c0       = nodes[idx].child[0];
+    c1       = nodes[idx].child[1];
+    area     = gk__bvhArea(nodes[idx].box);
+    combined = gk__bvhMergedArea(nodes[idx].box, box);
+    cost     = 2.0f * combined;
+    inherit  = 2.0f * (combined - area);
+
+    cost0 = gk__bvhMergedArea(nodes[c0].box, box) + inherit;
+    if (nodes[c0].child[0] != GK_BVH_NULL)
+      cost0 -= gk__bvhArea(nodes[c0].box);
+
+    cost1 = gk__bvhMergedArea(nodes[c1].box, box) + inherit;
+    if (nodes[c1].child[0] != GK_BVH_NULL)
+      cost1 -= gk__bvhArea(nodes[c1].box);
+
+    if (cost < cost0 && cost < cost1)
+      break;
+
+    idx = cost0 < cost1 ? c0 : c1;
+  }
+
+  sibling   = idx;
+  newParent = gk__bvhAlloc(bvh);
+  nodes     = bvh->nodes; /* realloc */
+  oldParent = nodes[sibling].parent;
+
+  nodes[newParent].parent   = oldParent;
+  nodes[newParent].child[0] = sibling;
+  nodes[newParent].child[1] = leaf;
+  nodes[sibling].parent     = newParent;
+  nodes[leaf].parent        = newParent;
+
+  if (oldParent != GK_BVH_NULL) {
+    if (nodes[oldParent].child[0] == sibling)
+      nodes[oldParent].child[0] = newParent;
+    else
+      nodes[oldParent].child[1] = newParent;
+  } else {
+    bvh->root = newParent;
+  }
+
+  gk__bvhRefitUp(bvh, newParent);
+}
+
+static
+_gk_hide
+void
+gk__bvhRemoveLeaf(GkBVH * __restrict bvh, uint32_t leaf) {
+  GkBVHNode *nodes;
+  uint32_t   parent, grandParent, sibling;
+
+  nodes = bvh->nodes;
+
+  if (leaf == bvh->root) {
+    bvh->root = GK_BVH_NULL;
+    return;
+  }
+
+  parent      = nodes[leaf].parent;
+  grandParent = nodes[parent].parent;
+  sibling     = nodes[parent].child[0] == leaf
+                  ? nodes[parent].child[1] : nodes[parent].child[0];
+
+  nodes[sibling].parent = grandParent;
+  gk__bvhFree(bvh, parent);
+
+  if (grandParent == GK_BVH_NULL) {
+    bvh->root = sibling;
+    return;
+  }
+
+  if (nodes[grandParent].child[0] == parent)
+    nodes[grandParent].child[0] = sibling;
+  else
+    nodes[grandParent].child[1] = sibling;
+
+  gk__bvhRefitUp(bvh, grandParent);
+}
+
+void
+gkBVHUpdate(GkBVH          * __restrict bvh,
+            GkGeometryInst * __restrict geomInst) {
+  GkBVHNode *leaf;
+  uint32_t   idx;
+  vec3       margin;
+
+  if ((idx = geomInst->bvhLeaf) != GK_BVH_NULL) {
+    leaf = &bvh->nodes[idx];
+
+    if (gk__bvhContains(leaf->box, geomInst->bbox)) {
+      glm_vec3_copy(geomInst->bbox[0], leaf->tight[0]);
+      glm_vec3_copy(geomInst->bbox[1], leaf->tight[1]);
+      glm_vec3_copy(geomInst->center, leaf->centerSum);
+      leaf->layers = geomInst->layers;
+      gk__bvhRefitBounds(bvh, leaf->parent);
+      return;
+    }
+
+    gk__bvhRemoveLeaf(bvh, idx);
+  } else {
+    idx               = gk__bvhAlloc(bvh);
+    geomInst->bvhLeaf = idx;
+  }
+
+  leaf            = &bvh->nodes[idx];
+  leaf->geomInst  = geomInst;
+  leaf->child[0]  = leaf->child[1] = GK_BVH_NULL;
+  leaf->height    = 0;
+  leaf->instCount = 1;
+  leaf->layers    = geomInst->layers;
+
+  glm_vec3_copy(geomInst->bbox[0], leaf->tight[0]);
+  glm_vec3_copy(geomInst->bbox[1], leaf->tight[1]);
+  glm_vec3_copy(geomInst->center, leaf->centerSum);
+
+  glm_vec3_sub(geomInst->bbox[1], geomInst->bbox[0], margin);
+  glm_vec3_scale(margin, GK_BVH_FAT_RATIO, margin);
+  glm_vec3_sub(geomInst->bbox[0], margin, leaf->box[0]);
+  glm_vec3_add(geomInst->bbox[1], margin, leaf->box[1]);
+
+  gk__bvhInsertLeaf(bvh, idx);
+}
+
+void
+gkBVHRemove(GkBVH          * __restrict bvh,
+            GkGeometryInst * __restrict geomInst) {
+  uint32_t idx;
+
+  if ((idx = geomInst->bvhLeaf) == GK_BVH_NULL)
+    return;
+
+  gk__bvhRemoveLeaf(bvh, idx);
+  gk__bvhFree(bvh, idx);
+  geomInst->bvhLeaf = GK_BVH_NULL;
+}
+
+void
+gkBVHBounds(GkBVH * __restrict bvh, vec3 box[2], vec3 center) {
+  GkBVHNode *root;
+
+  if (bvh->root == GK_BVH_NULL) {
+    glm_aabb_invalidate(box);
+    glm_vec3_zero(center);
+    return;
+  }
+
+  root = &bvh->nodes[bvh->root];
+
+  glm_vec3_copy(root->tight[0], box[0]);
+  glm_vec3_copy(root->tight[1], box[1]);
+  glm_vec3_divs(root->centerSum, (float)root->instCount, center);
+}
+
+void
+gkBVHDestroy(GkBVH * __restrict bvh) {
+  free(bvh->nodes);
+  memset(bvh, 0, sizeof(*bvh));
+}
@@ -0,0 +1,68 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef bvh_h
+#define bvh_h
+
+#include "../../include/gk/gk.h"
+
+/* index 0 is reserved for null, so zeroed memory is an empty tree */
+#define GK_BVH_NULL 0
+
+/* leaf boxes are enlarged by this ratio, small moves don't touch the tree */
+#define GK_BVH_FAT_RATIO 0.1f
+
+typedef struct GkBVHNode {
+  GkBBox          box;       /* fat box for leaves */
+  GkBBox          tight;     /* exact bounds of subtree */
+  vec3            centerSum; /* sum of instance centers in subtree */
+  GkGeometryInst *geomInst;  /* only for leaves    */
+  uint32_t        parent;
+  uint32_t        child[2];  /* child[0] is null for leaves */
+  uint32_t        instCount; /* instances in subtree */
+  uint32_t        layers;    /* union of instances' layers in subtree */
+  int32_t         height;    /* 0 for leaves, -1 for free nodes */
+  uint8_t         lastPlane; /* plane which rejected this node last time */
+} GkBVHNode;
+
+/*
+ dynamic AABB tree over geometry instances, nodes are stored in an array and
+ referenced by index so the array can grow. Free nodes are chained by parent.
+ */
+typedef struct GkBVH {
+  GkBVHNode *nodes;
+  uint32_t   root;
+  uint32_t   freeNode;
+  uint32_t   count;
+  uint32_t   size;
+} GkBVH;
+
+void
+gkBVHUpdate(GkBVH * __restrict bvh, GkGeometryInst * __restrict geomInst);
+
+void
+gkBVHRemove(GkBVH * __restrict bvh, GkGeometryInst * __restrict geomInst);
+
+/* exact bounds and average center of all instances, kept in root */
+void
+gkBVHBounds(GkBVH * __restrict bvh, vec3 box[2], vec3 center);
+
+void
+gkBVHDestroy(GkBVH * __restrict bvh);
+
+#endif /* bvh_h */
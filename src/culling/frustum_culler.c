@@ -19,9 +19,12 @@
 #include "frustum_culler.h"
 
 #include "../types/impl_scene.h"
-#include "../render/realtime/transp.h"
+#include "../types/impl_transform.h"
+#include "../render/realtime/packet.h"
+#include "bvh.h"
+#include "box_soa.h"
+#include "../job/job.h"
 
-#include "../bbox/scene_bbox.h"
 
 #include <math.h>
 #include <string.h>
@@ -33,11 +36,102 @@
    http://old.cescg.org/CESCG-2002/DSykoraJJelinek/
  */
 
-extern uint32_t gk_nodesPerPage;
-
 #define rnListSizeInit(x) (sizeof(*x) + sizeof(void *) * 1024)
 #define rnListSize(x)     (sizeof(*x) + sizeof(void *) * x->size)
 
+/* tree is balanced, its height is far below this */
+#define GK_CULL_STACK_SIZE 256
+
+#define GK_CULL_ALL_PLANES 0x3F
+
+/* subtrees for parallel culling and tree size to start using jobs */
+#define GK_CULL_SPLIT        64
+#define GK_CULL_PARALLEL_MIN 512
+
+/* unused boxes allowed between two leaves to test them in one run */
+#define GK_CULL_RUN_GAP      16
+
+typedef enum GkCullResult {
+  GK_CULL_OUTSIDE   = 0,
+  GK_CULL_INTERSECT = 1,
+  GK_CULL_INSIDE    = 2
+} GkCullResult;
+
+static GkCullStats gk__cullStats;
+
+/* layers which are not hidden by scene or camera */
+static
+GK_INLINE
+uint32_t
+gk__cullLayers(GkScene * __restrict scene, GkCamera * __restrict cam) {
+  return ~(scene->hiddenLayers | cam->hiddenLayers);
+}
+
+/*
+ only planes in planeMask are tested, planes which contain the box are removed
+ from mask so children don't test them again. The plane which rejected the box
+ last time is tested first, objects tend to fail on the same plane.
+ */
+static
+GK_INLINE
+GkCullResult
+gk__cullBox(vec3                     box[2],
+            vec4                     planes[6],
+            uint32_t    * __restrict planeMask,
+            uint8_t     * __restrict lastPlane,
+            GkCullStats * __restrict stats) {
+  float   *p, dp, dn;
+  uint32_t mask;
+  int32_t  i, k;
+
+  mask = *planeMask;
+
+  for (i = -1; i < 6; i++) {
+    k = i < 0 ? *lastPlane : i;
+    if (!(mask & (1u << k)) || (i == *lastPlane))
+      continue;
+
+    p = planes[k];
+    stats->planeTests++;
+
+    /* farthest (p) and nearest (n) corners along plane normal */
+    dp = glm_max(p[0] * box[0][0], p[0] * box[1][0])
+       + glm_max(p[1] * box[0][1], p[1] * box[1][1])
+       + glm_max(p[2] * box[0][2], p[2] * box[1][2]);
+
+    if (dp < -p[3]) {
+      if (i < 0)
+        stats->lastPlaneHits++;
+
+      *lastPlane = k;
+      return GK_CULL_OUTSIDE;
+    }
+
+    dn = glm_min(p[0] * box[0][0], p[0] * box[1][0])
+       + glm_min(p[1] * box[0][1], p[1] * box[1][1])
+       + glm_min(p[2] * box[0][2], p[2] * box[1][2]);
+
+    if (dn >= -p[3])
+      mask &= ~(1u << k);
+  }
+
+  *planeMask = mask;
+
+  return mask ? GK_CULL_INTERSECT : GK_CULL_INSIDE;
+}
+
+static
+GK_INLINE
+uint32_t
+gk__planeCount(uint32_t planeMask) {
+  uint32_t n;
+
+  for (n = 0; planeMask; n++)
+    planeMask &= planeMask - 1;
+
+  return n;
+}
+
 bool
 gkPrimIsInFrustum(GkScene     * __restrict scene,
                   GkCamera    * __restrict cam,
@@ -45,27 +139,453 @@ gkPrimIsInFrustum(GkScene     * __restrict scene,
   return glm_aabb_frustum(prim->bbox, cam->frustum.planes);
 }
 
+/*
+ leaves which intersect frustum are collected while walking the tree, then
+ their box ranges are sorted by slot and tested in long contiguous runs.
+ Leaves keep walk order, bit is where instance's range starts in masks.
+ */
+typedef struct GkCullLeaf {
+  GkGeometryInst *geomInst;
+  uint32_t        planeMask;
+  uint32_t        bit;
+} GkCullLeaf;
+
+typedef struct GkCullBatch {
+  GkCullLeaf *leaves;
+  uint64_t   *order;    /* slot << 32 | leaf index */
+  uint32_t   *masks;
+  uint32_t    count;
+  uint32_t    size;
+  uint32_t    nmasks;
+  uint32_t    maskSize;
+} GkCullBatch;
+
+static GkCullBatch gk__cullBatch;
+
+static
+GK_INLINE
+bool
+gk__cullBit(uint32_t * __restrict mask, uint32_t b) {
+  return mask[b >> 5] & (1u << (b & 31));
+}
+
+static
+int
+gk__cullSlotCmp(const void *a, const void *b) {
+  uint64_t ka, kb;
+
+  ka = *(const uint64_t *)a;
+  kb = *(const uint64_t *)b;
+
+  return (ka > kb) - (ka < kb);
+}
+
+static
+void
+gk__cullBatchAdd(GkCullBatch    * __restrict batch,
+                 GkGeometryInst * __restrict geomInst,
+                 uint32_t                    planeMask) {
+  GkCullLeaf *leaf;
+
+  if (batch->count == batch->size) {
+    batch->size   = batch->size ? batch->size * 2 : 256;
+    batch->leaves = realloc(batch->leaves, batch->size * sizeof(*batch->leaves));
+    batch->order  = realloc(batch->order,  batch->size * sizeof(*batch->order));
+  }
+
+  leaf            = &batch->leaves[batch->count++];
+  leaf->geomInst  = geomInst;
+  leaf->planeMask = planeMask;
+  leaf->bit       = 0;
+}
+
+static
+void
+gk__cullRun(GkSceneImpl * __restrict sceneImpl,
+            GkCullBatch * __restrict batch,
+            vec4                     planes[6],
+            uint32_t                 start,
+            uint32_t                 end,
+            uint32_t                 planeMask,
+            GkCullStats * __restrict stats) {
+  uint32_t count, nwords;
+
+  count  = end - start;
+  nwords = (count + 31) / 32;
+
+  if (batch->nmasks + nwords > batch->maskSize) {
+    batch->maskSize = (batch->nmasks + nwords) * 2;
+    batch->masks    = realloc(batch->masks,
+                              batch->maskSize * sizeof(*batch->masks));
+  }
+
+  gkCullBoxes(&sceneImpl->cullBoxes,
+              start,
+              count,
+              planes,
+              planeMask,
+              batch->masks + batch->nmasks);
+
+  batch->nmasks      += nwords;
+  stats->boxesTested += count;
+  stats->planeTests  += count * gk__planeCount(planeMask);
+}
+
+/*
+ tests exact boxes of collected instances and their primitives. Leaves of a
+ run may intersect different planes, run tests union of them; a plane which
+ contains the parent also contains the exact boxes so result is the same.
+ */
+static
+void
+gk__cullBatchTest(GkSceneImpl * __restrict sceneImpl,
+                  GkCullBatch * __restrict batch,
+                  vec4                     planes[6],
+                  GkCullStats * __restrict stats) {
+  GkCullLeaf     *leaf;
+  GkGeometryInst *geomInst;
+  uint32_t        i, n, slot, start, end, base, planeMask;
+
+  batch->nmasks = 0;
+
+  /* fully inside instances are not tested */
+  for (i = n = 0; i < batch->count; i++) {
+    if (batch->leaves[i].planeMask)
+      batch->order[n++] = (uint64_t)batch->leaves[i].geomInst->cullSlot << 32
+                        | i;
+  }
+
+  if (n == 0)
+    return;
+
+  qsort(batch->order, n, sizeof(*batch->order), gk__cullSlotCmp);
+
+  start = end = base = planeMask = 0;
+
+  for (i = 0; i < n; i++) {
+    leaf     = &batch->leaves[(uint32_t)batch->order[i]];
+    geomInst = leaf->geomInst;
+    slot     = geomInst->cullSlot;
+
+    /* too far from current run, test it then start a new one */
+    if (i == 0 || slot > end + GK_CULL_RUN_GAP) {
+      if (i > 0)
+        gk__cullRun(sceneImpl, batch, planes, start, end, planeMask, stats);
+
+      start     = slot;
+      base      = batch->nmasks * 32;
+      planeMask = 0;
+    }
+
+    leaf->bit  = base + slot - start;
+    end        = slot + geomInst->primc + 1;
+    planeMask |= leaf->planeMask;
+  }
+
+  gk__cullRun(sceneImpl, batch, planes, start, end, planeMask, stats);
+}
+
+static
+void
+gk__cullAddPrims(GkScene        * __restrict scene,
+                 GkCamera       * __restrict cam,
+                 GkFrustum      * __restrict frustum,
+                 GkRenderList   *            rl[2],
+                 GkGeometryInst * __restrict geomInst,
+                 uint32_t                    planeMask,
+                 uint32_t       * __restrict mask,
+                 uint32_t                    bit) {
+  GkPrimInst   *prims, *primInst;
+  GkDrawPacket *pkt;
+  uint32_t      b, gpuGen;
+  int32_t       j, primc, isTransp;
+
+  prims  = geomInst->prims;
+  primc  = geomInst->primc;
+  gpuGen = ((GkSceneImpl *)scene)->gpuCullGen;
+
+  /* all prims are visible if instance is fully inside */
+  if (!planeMask)
+    glm_aabb_merge(frustum->visibleBounds,
+                   geomInst->bbox,
+                   frustum->visibleBounds);
+
+  for (j = 0; j < primc; j++) {
+    primInst = &prims[j];
+    b        = bit + j + 1;
+
+    if (planeMask && !gk__cullBit(mask, b))
+      continue;
+
+    if (planeMask)
+      glm_aabb_merge(frustum->visibleBounds,
+                     primInst->bbox,
+                     frustum->visibleBounds);
+
+    pkt = gkDrawPacketFor(scene, geomInst, primInst);
+
+    /* culled and drawn on GPU, see frustum_gpu.c */
+    if (gpuGen && pkt->gpuCullGen == gpuGen)
+      continue;
+
+    isTransp = pkt->isTransp;
+    if (rl[isTransp]->count == rl[isTransp]->size) {
+      rl[isTransp]->size += 512;
+      rl[isTransp] = realloc(rl[isTransp], rnListSize(rl[isTransp]));
+    }
+
+    rl[isTransp]->items[rl[isTransp]->count] = primInst;
+    rl[isTransp]->count++;
+  } /* for each prim */
+
+  /* final transform is only needed for visible instances */
+  gkCalcFinalTransf(scene, cam, geomInst->trans);
+
+  flist_sp_insert(&frustum->modelInsList, geomInst);
+}
+
+/* adds instances which passed gk__cullBatchTest() in walk order */
+static
+void
+gk__cullBatchEmit(GkScene      * __restrict scene,
+                  GkCamera     * __restrict cam,
+                  GkFrustum    * __restrict frustum,
+                  GkRenderList *            rl[2],
+                  GkCullBatch  * __restrict batch) {
+  GkCullLeaf *leaf;
+  uint32_t    i;
+
+  for (i = 0; i < batch->count; i++) {
+    leaf = &batch->leaves[i];
+
+    if (leaf->planeMask && !gk__cullBit(batch->masks, leaf->bit))
+      continue;
+
+    gk__cullAddPrims(scene,
+                     cam,
+                     frustum,
+                     rl,
+                     leaf->geomInst,
+                     leaf->planeMask,
+                     batch->masks,
+                     leaf->bit);
+  }
+}
+
+typedef struct GkCullTask {
+  GkCullBatch batch;
+  GkCullStats stats;
+  uint32_t    root;
+  uint32_t    planeMask;
+  bool        tested;    /* root is already tested while splitting */
+} GkCullTask;
+
+typedef struct GkCullJob {
+  GkSceneImpl *sceneImpl;
+  GkCullTask  *tasks;
+  vec4        *planes;
+  uint32_t     layers;    /* visible layers */
+} GkCullJob;
+
+static GkCullTask gk__cullTasks[GK_CULL_SPLIT];
+
+static
+void
+gk__cullTaskRun(void *data, uint32_t begin, uint32_t end) {
+  GkCullJob  *job;
+  GkCullTask *task;
+  GkBVHNode  *nodes, *node;
+  uint32_t    stack[GK_CULL_STACK_SIZE];
+  uint8_t     masks[GK_CULL_STACK_SIZE];
+  uint32_t    t, planeMask;
+  int32_t     top;
+  bool        tested;
+
+  job   = data;
+  nodes = job->sceneImpl->bvh.nodes;
+
+  for (t = begin; t < end; t++) {
+    task         = &job->tasks[t];
+    top          = 0;
+    stack[top]   = task->root;
+    masks[top++] = (uint8_t)task->planeMask;
+    tested       = task->tested;
+
+    while (top > 0) {
+      top--;
+      node      = &nodes[stack[top]];
+      planeMask = masks[top];
+
+      /* whole subtree is in hidden layers */
+      if (!(node->layers & job->layers)) {
+        tested = false;
+        continue;
+      }
+
+      if (planeMask && !tested) {
+        task->stats.nodesVisited++;
+
+        switch (gk__cullBox(node->box,
+                            job->planes,
+                            &planeMask,
+                            &node->lastPlane,
+                            &task->stats)) {
+          case GK_CULL_OUTSIDE:
+            task->stats.nodesOutside++;
+            continue;
+          case GK_CULL_INSIDE:
+            task->stats.nodesInside++;
+            break;
+          default: break;
+        }
+      }
+
+      tested = false;
+
+      if (node->child[0] == GK_BVH_NULL) {
+        gk__cullBatchAdd(&task->batch, node->geomInst, planeMask);
+        continue;
+      }
+
+      stack[top]   = node->child[0];
+      masks[top++] = planeMask;
+      stack[top]   = node->child[1];
+      masks[top++] = planeMask;
+    }
+
+    gk__cullBatchTest(job->sceneImpl, &task->batch, job->planes, &task->stats);
+  }
+}
+
+/*
+ top of tree is walked here breadth first until there are GK_CULL_SPLIT
+ subtrees, jobs walk subtrees and test instances then visible ones are added
+ to render lists in task order. Split does not depend on worker count.
+ */
+static
+void
+gk__cullFrustumParallel(GkScene      * __restrict scene,
+                        GkCamera     * __restrict cam,
+                        GkRenderList *            rl[2]) {
+  GkSceneImpl   *sceneImpl;
+  GkFrustum     *frustum;
+  GkBVHNode     *nodes, *node;
+  GkCullTask    *task;
+  GkCullJob      job;
+  uint32_t       items[GK_CULL_SPLIT * 4], itemMasks[GK_CULL_SPLIT * 4];
+  uint32_t       head, tail, ntasks, planeMask, layers, i;
+
+  sceneImpl = (GkSceneImpl *)scene;
+  frustum   = &cam->frustum;
+  nodes     = sceneImpl->bvh.nodes;
+  layers    = gk__cullLayers(scene, cam);
+  ntasks    = 0;
+  head      = 0;
+  tail      = 0;
+
+  items[tail]       = sceneImpl->bvh.root;
+  itemMasks[tail++] = GK_CULL_ALL_PLANES;
+
+  while (head < tail
+         && tail - head + ntasks < GK_CULL_SPLIT
+         && tail + 2 <= GK_ARRAY_LEN(items)) {
+    node      = &nodes[items[head]];
+    planeMask = itemMasks[head];
+    head++;
+
+    if (!(node->layers & layers))
+      continue;
+
+    if (planeMask) {
+      gk__cullStats.nodesVisited++;
+
+      switch (gk__cullBox(node->box,
+                          frustum->planes,
+                          &planeMask,
+                          &node->lastPlane,
+                          &gk__cullStats)) {
+        case GK_CULL_OUTSIDE:
+          gk__cullStats.nodesOutside++;
+          continue;
+        case GK_CULL_INSIDE:
+          gk__cullStats.nodesInside++;
+          break;
+        default: break;
+      }
+    }
+
+    if (node->child[0] == GK_BVH_NULL) {
+      task            = &gk__cullTasks[ntasks++];
+      task->root      = (uint32_t)(node - nodes);
+      task->planeMask = planeMask;
+      task->tested    = true;
+      continue;
+    }
+
+    items[tail]       = node->child[0];
+    itemMasks[tail++] = planeMask;
+    items[tail]       = node->child[1];
+    itemMasks[tail++] = planeMask;
+  }
+
+  for (; head < tail; head++) {
+    task            = &gk__cullTasks[ntasks++];
+    task->root      = items[head];
+    task->planeMask = itemMasks[head];
+    task->tested    = false;
+  }
+
+  for (i = 0; i < ntasks; i++) {
+    task              = &gk__cullTasks[i];
+    task->batch.count = 0;
+    memset(&task->stats, 0, sizeof(task->stats));
+  }
+
+  job.sceneImpl = sceneImpl;
+  job.tasks     = gk__cullTasks;
+  job.planes    = frustum->planes;
+  job.layers    = layers;
+
+  gkJobParallelFor(ntasks, 1, gk__cullTaskRun, &job);
+
+  for (i = 0; i < ntasks; i++) {
+    task = &gk__cullTasks[i];
+
+    gk__cullBatchEmit(scene, cam, frustum, rl, &task->batch);
+
+    gk__cullStats.planeTests    += task->stats.planeTests;
+    gk__cullStats.boxesTested   += task->stats.boxesTested;
+    gk__cullStats.nodesVisited  += task->stats.nodesVisited;
+    gk__cullStats.nodesInside   += task->stats.nodesInside;
+    gk__cullStats.nodesOutside  += task->stats.nodesOutside;
+    gk__cullStats.lastPlaneHits += task->stats.lastPlaneHits;
+  }
+}
+
 GK_EXPORT
 void
 gkCullFrustum(GkScene  * __restrict scene,
               GkCamera * __restrict cam) {
-  GkNodePage      *np;
   GkSceneImpl     *sceneImpl;
-  GkNode          *node;
-  GkGeometryInst  *geomInst;
+  GkBVHNode       *nodes, *node;
   GkFrustum       *frustum;
   GkRenderList    *rl[2];
   vec4            *camPlanes;
-  size_t           i;
+  uint32_t         stack[GK_CULL_STACK_SIZE];
+  uint8_t          masks[GK_CULL_STACK_SIZE];
+  uint32_t         idx, planeMask, layers;
+  int32_t          top;
 
   sceneImpl = (GkSceneImpl *)scene;
-  np        = sceneImpl->lastPage;
   frustum   = &cam->frustum;
   camPlanes = frustum->planes;
+  layers    = gk__cullLayers(scene, cam);
 
   flist_sp_destroy(&frustum->modelInsList);
   frustum->modelInsList = NULL;
 
+  glm_aabb_invalidate(frustum->visibleBounds);
+
   if (frustum->opaque)
     frustum->opaque->count = 0;
   else {
@@ -85,54 +605,66 @@ gkCullFrustum(GkScene  * __restrict scene,
   rl[0] = frustum->opaque;
   rl[1] = frustum->transp;
 
-  while (np) {
-    for (i = 0; i < np->count; i++) {
-      node = &np->nodes[i];
-
-      /* unallocated node */
-      if (!(node->flags & GK_NODEF_NODE)
-          || !(geomInst = node->geom))
-        continue;
-
-      while (geomInst) {
-        if (glm_aabb_frustum(geomInst->bbox, camPlanes)) {
-          GkPrimInst *prims, *primInst;
-          int32_t     j, primc;
-
-          prims = geomInst->prims;
-          primc = geomInst->primc;
+  gk__cullBatch.count = 0;
 
-          for (j = 0; j < primc; j++) {
-            if (glm_aabb_frustum(prims[j].bbox, camPlanes)) {
-              int isTransp;
+  if ((idx = sceneImpl->bvh.root) == GK_BVH_NULL)
+    goto dn;
 
-              primInst = &prims[j];
-
-              (void)gkMaterialFor(scene, geomInst, primInst);
-
-              isTransp = gkPrimIsTransparent(scene, geomInst, primInst);
-              if (rl[isTransp]->count == rl[isTransp]->size) {
-                rl[isTransp]->size += 512;
-                rl[isTransp] = realloc(rl[isTransp], rnListSize(rl[isTransp]));
-              }
-
-              rl[isTransp]->items[rl[isTransp]->count] = primInst;
-              rl[isTransp]->count++;
-
-              gkUpdateSceneAABB(scene, primInst->bbox);
-            }
-          } /* for each prim */
-          
-          flist_sp_insert(&frustum->modelInsList, geomInst);
-        }
+  if (sceneImpl->bvh.count >= GK_CULL_PARALLEL_MIN && gkJobWorkerCount() > 0) {
+    gk__cullFrustumParallel(scene, cam, rl);
+    goto dn;
+  }
 
-        geomInst = geomInst->next;
+  /* children only test planes which their parent intersects, subtrees
+     which are fully inside are accepted without testing */
+  nodes        = sceneImpl->bvh.nodes;
+  top          = 0;
+  stack[top]   = idx;
+  masks[top++] = GK_CULL_ALL_PLANES;
+
+  while (top > 0) {
+    top--;
+    node      = &nodes[stack[top]];
+    planeMask = masks[top];
+
+    /* whole subtree is in hidden layers */
+    if (!(node->layers & layers))
+      continue;
+
+    if (planeMask) {
+      gk__cullStats.nodesVisited++;
+
+      switch (gk__cullBox(node->box,
+                          camPlanes,
+                          &planeMask,
+                          &node->lastPlane,
+                          &gk__cullStats)) {
+        case GK_CULL_OUTSIDE:
+          gk__cullStats.nodesOutside++;
+          continue;
+        case GK_CULL_INSIDE:
+          gk__cullStats.nodesInside++;
+          break;
+        default: break;
       }
     }
 
-    np = np->next;
+    if (node->child[0] == GK_BVH_NULL) {
+      /* leaf box is enlarged, exact one is tested with primitives later */
+      gk__cullBatchAdd(&gk__cullBatch, node->geomInst, planeMask);
+      continue;
+    }
+
+    stack[top]   = node->child[0];
+    masks[top++] = planeMask;
+    stack[top]   = node->child[1];
+    masks[top++] = planeMask;
   }
 
+  gk__cullBatchTest(sceneImpl, &gk__cullBatch, camPlanes, &gk__cullStats);
+  gk__cullBatchEmit(scene, cam, frustum, rl, &gk__cullBatch);
+
+dn:
   /* because of realloc */
   frustum->opaque = rl[0];
   frustum->transp = rl[1];
@@ -145,6 +677,7 @@ gkCullSubFrustum(GkFrustum * __restrict frustum,
   GkPrimInst  **it;
   GkRenderList *rl[2], *subrl[2];
   size_t        i, j, c;
+  uint32_t      planeMask;
 
   if (subfrustum->opaque)
     subfrustum->opaque->count = 0;
@@ -162,6 +695,8 @@ gkCullSubFrustum(GkFrustum * __restrict frustum,
     subfrustum->transp->size  = 1024;
   }
 
+  glm_aabb_invalidate(subfrustum->visibleBounds);
+
   rl[0]    = frustum->opaque;
   rl[1]    = frustum->transp;
   subrl[0] = subfrustum->opaque;
@@ -172,7 +707,12 @@ gkCullSubFrustum(GkFrustum * __restrict frustum,
     it = rl[i]->items;
 
     for (j = 0; j < c; j++) {
-      if (glm_aabb_frustum(it[j]->bbox, subfrustum->planes)) {
+      planeMask = GK_CULL_ALL_PLANES;
+      if (gk__cullBox(it[j]->bbox,
+                      subfrustum->planes,
+                      &planeMask,
+                      &it[j]->cullPlane,
+                      &gk__cullStats) != GK_CULL_OUTSIDE) {
         if (subrl[i]->count == subrl[i]->size) {
           subrl[i]->size += 512;
           subrl[i] = realloc(subrl[i], rnListSize(subrl[i]));
@@ -180,6 +720,10 @@ gkCullSubFrustum(GkFrustum * __restrict frustum,
 
         subrl[i]->items[subrl[i]->count] = it[j];
         subrl[i]->count++;
+
+        glm_aabb_merge(subfrustum->visibleBounds,
+                       it[j]->bbox,
+                       subfrustum->visibleBounds);
       }
     }
   }
@@ -193,22 +737,18 @@ GK_EXPORT
 void
 gkBoxInFrustum(GkFrustum * __restrict frustum,
                vec3                   box[2]) {
-  GkPrimInst  **it;
-  GkRenderList *rl[2];
-  vec3          t[2];
-  size_t        i, j, c;
-
-  glm_aabb_invalidate(t);
-
-  rl[0] = frustum->opaque;
-  rl[1] = frustum->transp;
+  /* merged while culling, no need to walk render lists again */
+  memcpy(box, frustum->visibleBounds, sizeof(frustum->visibleBounds));
+}
 
-  for (i = 0; i < 2; i++) {
-    c  = rl[i]->count;
-    it = rl[i]->items;
-    for (j = 0; j < c; j++)
-      glm_aabb_merge(t, it[j]->bbox, t);
-  }
+GK_EXPORT
+void
+gkCullStats(GkCullStats * __restrict stats) {
+  *stats = gk__cullStats;
+}
 
-  memcpy(box, t, sizeof(t));
+GK_EXPORT
+void
+gkResetCullStats(void) {
+  memset(&gk__cullStats, 0, sizeof(gk__cullStats));
 }
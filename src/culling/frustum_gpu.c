@@ -0,0 +1,515 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../common.h"
+#include "frustum_gpu.h"
+
+#include "../../include/gk/opt.h"
+#include "../../include/gk/platform.h"
+#include "../types/impl_scene.h"
+#include "../shader/builtin_shader.h"
+#include "../program/uniform_cache.h"
+#include "../render/realtime/packet.h"
+#include "../render/realtime/material.h"
+#include "../render/realtime/instance.h"
+#include "../render/realtime/mega.h"
+#include "../render/realtime/mdi.h"
+#include "box_soa.h"
+
+#include <stdlib.h>
+
+#if defined(GK_GPU_CULLING) && defined(GK_MULTI_DRAW_INDIRECT)
+
+#define GK_GPUCULL_GROUP_SIZE 64
+
+/*
+ every candidate owns one command slot in its group's range, visible ones are
+ compacted to the front of the range; rest stay zero so they draw nothing.
+ */
+
+enum {
+  GK_GPUCULL_BOXES    = 0,
+  GK_GPUCULL_DRAWS    = 1,
+  GK_GPUCULL_INST_IN  = 2,
+  GK_GPUCULL_CMDS     = 3,
+  GK_GPUCULL_INST_OUT = 4,
+  GK_GPUCULL_COUNTERS = 5,
+  GK_GPUCULL_BUFF_COUNT
+};
+
+/* std430 layout of Draw in cull_frustum.glsl */
+typedef struct GkGPUCullDraw {
+  uint32_t slot;
+  uint32_t count;
+  uint32_t firstIndex;
+  int32_t  baseVertex;
+  uint32_t cmdBase;
+  uint32_t group;
+  uint32_t pad[2];
+} GkGPUCullDraw;
+
+typedef struct GkGPUCullGroup {
+  GkPrimInst *first;
+  uint32_t    start;
+  uint32_t    count;
+} GkGPUCullGroup;
+
+typedef struct GkGPUCullCand {
+  GkPrimInst *primInst;
+  uint32_t    slot;
+} GkGPUCullCand;
+
+typedef struct GkGPUCull {
+  GkGPUCullCand  *cands;
+  GkGPUCullGroup *groups;
+  GkPrimInst    **waits;      /* eligible but pipeline is compiling */
+  uint32_t        candCount;
+  uint32_t        candSize;
+  uint32_t        waitCount;
+  uint32_t        waitSize;
+  uint32_t        groupCount;
+  uint32_t        groupSize;
+  uint32_t        boxVersion; /* box SoA version at last build */
+  uint32_t        boxSize;    /* floats per box array on GPU   */
+  uint32_t        layers;
+  uint32_t        gen;
+  GLuint          buffs[GK_GPUCULL_BUFF_COUNT];
+} GkGPUCull;
+
+/* only default render func draws GPU culled groups */
+static
+_gk_hide
+bool
+gk__gpuCullActive(GkScene * __restrict scene) {
+  GkSceneImpl *sceneImpl;
+
+  sceneImpl = (GkSceneImpl *)scene;
+
+  return gk_opt(GK_OPT_GPU_CULLING)
+         && gk_opt(GK_OPT_MULTI_DRAW)
+         && gkPlatfomInfo(GK_PLI_MULTI_DRAW)
+         && gkPlatfomInfo(GK_PLI_COMPUTE)
+         && !scene->renderPrimFunc
+         && !sceneImpl->renderFunc
+         && !sceneImpl->lightIterFunc
+         && !sceneImpl->overridePass
+         && !GK_FLG(scene->flags, GK_SCENEF_TRANSP)
+         && !GK_FLG(scene->flags, GK_SCENEF_SHADOWS)
+         && !GK_FLG(scene->flags, GK_SCENEF_DRAW_PRIM_BBOX);
+}
+
+static
+_gk_hide
+bool
+gk__gpuCullEligible(GkScene        * __restrict scene,
+                    GkGeometryInst * __restrict geomInst,
+                    GkPrimInst     * __restrict primInst) {
+  return !gkDrawPacketFor(scene, geomInst, primInst)->isTransp
+         && !primInst->hasSkin
+         && !primInst->hasMorph
+         && !primInst->vertexAttachments
+         && gkMegaAllocFor(primInst->prim);
+}
+
+/* instanced pipeline must be ready for every light, there is no fallback */
+static
+_gk_hide
+bool
+gk__gpuCullReady(GkScene    * __restrict scene,
+                 GkPrimInst * __restrict primInst) {
+  GkSceneImpl *sceneImpl;
+  GkLight     *light;
+  bool         ready;
+
+  sceneImpl = (GkSceneImpl *)scene;
+  light     = (GkLight *)scene->lights;
+  ready     = true;
+
+  sceneImpl->instanceCount = 1;
+
+  do {
+    if (!gkDrawPacketPass(scene, light, primInst)) {
+      ready = false;
+      break;
+    }
+  } while (light && (light = (GkLight *)light->ref.next));
+
+  sceneImpl->instanceCount = 0;
+
+  return ready;
+}
+
+/* candidates of a group must share everything which selects a pipeline */
+static
+int
+gk__gpuCullCmp(const void *a, const void *b) {
+  const GkPrimInst *pa, *pb;
+  const void       *ka[5], *kb[5];
+  int               i;
+
+  pa = ((const GkGPUCullCand *)a)->primInst;
+  pb = ((const GkGPUCullCand *)b)->primInst;
+
+  ka[0] = pa->prim->mega->layout; kb[0] = pb->prim->mega->layout;
+  ka[1] = pa->packet->material;   kb[1] = pb->packet->material;
+  ka[2] = pa->activeMaterial;     kb[2] = pb->activeMaterial;
+  ka[3] = pa->bindTexture;        kb[3] = pb->bindTexture;
+  ka[4] = (void *)(uintptr_t)pa->prim->mode;
+  kb[4] = (void *)(uintptr_t)pb->prim->mode;
+
+  for (i = 0; i < 5; i++) {
+    if (ka[i] != kb[i])
+      return (uintptr_t)ka[i] < (uintptr_t)kb[i] ? -1 : 1;
+  }
+
+  return 0;
+}
+
+static
+_gk_hide
+void
+gk__gpuCullUploadBoxes(GkGPUCull * __restrict gc,
+                       GkBoxSoA  * __restrict soa,
+                       uint32_t               start,
+                       uint32_t               end) {
+  uint32_t k;
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, gc->buffs[GK_GPUCULL_BOXES]);
+
+  if (gc->boxSize != soa->size) {
+    gc->boxSize = soa->size;
+    start       = 0;
+    end         = soa->count;
+
+    glBufferData(GL_COPY_WRITE_BUFFER,
+                 sizeof(float) * 6 * gc->boxSize,
+                 NULL,
+                 GL_DYNAMIC_DRAW);
+  }
+
+  if (end <= start)
+    return;
+
+  for (k = 0; k < 6; k++) {
+    glBufferSubData(GL_COPY_WRITE_BUFFER,
+                    sizeof(float) * (k * gc->boxSize + start),
+                    sizeof(float) * (end - start),
+                    soa->v[k] + start);
+  }
+}
+
+static
+_gk_hide
+void
+gk__gpuCullBuild(GkScene   * __restrict scene,
+                 GkGPUCull * __restrict gc,
+                 uint32_t               layers) {
+  GkSceneImpl    *sceneImpl;
+  GkBVHNode      *node;
+  GkGeometryInst *geomInst;
+  GkPrimInst     *primInst;
+  GkGPUCullCand  *cand;
+  GkGPUCullGroup *grp;
+  GkGPUCullDraw  *draws;
+  float          *inst;
+  size_t          n;
+  uint32_t        i, g;
+  int32_t         j;
+
+  sceneImpl     = (GkSceneImpl *)scene;
+  gc->candCount = 0;
+  gc->waitCount = 0;
+  gc->gen++;
+
+  /* each instance is in one leaf */
+  for (i = 1; i < sceneImpl->bvh.count; i++) {
+    node = &sceneImpl->bvh.nodes[i];
+    if (node->height != 0
+        || !(geomInst = node->geomInst)
+        || !geomInst->cullSlot
+        || !(geomInst->layers & layers))
+      continue;
+
+    for (j = 0; j < geomInst->primc; j++) {
+      primInst = &geomInst->prims[j];
+      if (!gk__gpuCullEligible(scene, geomInst, primInst))
+        continue;
+
+      /* keep it on CPU lists until instanced pipeline is compiled */
+      if (!gk__gpuCullReady(scene, primInst)) {
+        if (gc->waitCount == gc->waitSize) {
+          gc->waitSize = gc->waitSize ? gc->waitSize * 2 : 64;
+          gc->waits    = realloc(gc->waits, gc->waitSize * sizeof(*gc->waits));
+        }
+
+        gc->waits[gc->waitCount++] = primInst;
+        continue;
+      }
+
+      if (gc->candCount == gc->candSize) {
+        gc->candSize = gc->candSize ? gc->candSize * 2 : 1024;
+        gc->cands    = realloc(gc->cands, gc->candSize * sizeof(*gc->cands));
+      }
+
+      cand           = &gc->cands[gc->candCount++];
+      cand->primInst = primInst;
+      cand->slot     = geomInst->cullSlot + 1 + j;
+    }
+  }
+
+  qsort(gc->cands, gc->candCount, sizeof(*gc->cands), gk__gpuCullCmp);
+
+  n     = gc->candCount;
+  draws = malloc(sizeof(*draws) * (n ? n : 1));
+  inst  = malloc(GK_INST_STRIDE * (n ? n : 1));
+  grp   = NULL;
+
+  gc->groupCount = 0;
+
+  for (i = 0; i < n; i++) {
+    cand     = &gc->cands[i];
+    primInst = cand->primInst;
+
+    if (!grp || gk__gpuCullCmp(&gc->cands[grp->start], cand) != 0) {
+      if (gc->groupCount == gc->groupSize) {
+        gc->groupSize += GK_GPUCULL_GROUP_SIZE;
+        gc->groups     = realloc(gc->groups,
+                                 gc->groupSize * sizeof(*gc->groups));
+      }
+
+      grp        = &gc->groups[gc->groupCount++];
+      grp->first = primInst;
+      grp->start = i;
+      grp->count = 0;
+    }
+
+    grp->count++;
+    g = gc->groupCount - 1;
+
+    draws[i].slot       = cand->slot;
+    draws[i].count      = primInst->prim->count;
+    draws[i].firstIndex = primInst->prim->mega->firstIndex;
+    draws[i].baseVertex = primInst->prim->mega->baseVertex;
+    draws[i].cmdBase    = grp->start;
+    draws[i].group      = g;
+    draws[i].pad[0]     = draws[i].pad[1] = 0;
+
+    gkInstanceData(primInst->trans, inst + i * GK_INST_FLOATS);
+
+    /* frustum culler skips it while building render lists */
+    primInst->packet->gpuCullGen = gc->gen;
+  }
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, gc->buffs[GK_GPUCULL_DRAWS]);
+  glBufferData(GL_COPY_WRITE_BUFFER, sizeof(*draws) * n, draws, GL_STATIC_DRAW);
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, gc->buffs[GK_GPUCULL_INST_IN]);
+  glBufferData(GL_COPY_WRITE_BUFFER, GK_INST_STRIDE * n, inst, GL_DYNAMIC_DRAW);
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, gc->buffs[GK_GPUCULL_CMDS]);
+  glBufferData(GL_COPY_WRITE_BUFFER,
+               sizeof(GkDrawElementsIndirect) * n,
+               NULL,
+               GL_DYNAMIC_COPY);
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, gc->buffs[GK_GPUCULL_INST_OUT]);
+  glBufferData(GL_COPY_WRITE_BUFFER, GK_INST_STRIDE * n, NULL, GL_DYNAMIC_COPY);
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, gc->buffs[GK_GPUCULL_COUNTERS]);
+  glBufferData(GL_COPY_WRITE_BUFFER,
+               sizeof(uint32_t) * gc->groupCount,
+               NULL,
+               GL_DYNAMIC_COPY);
+
+  free(draws);
+  free(inst);
+
+  gc->boxSize             = 0; /* upload all */
+  gc->boxVersion          = sceneImpl->cullBoxes.version;
+  gc->layers              = layers;
+  sceneImpl->gpuCullGen   = gc->gen;
+  sceneImpl->gpuCullDirty = false;
+}
+
+static
+_gk_hide
+bool
+gk__gpuCullWaitDone(GkScene   * __restrict scene,
+                    GkGPUCull * __restrict gc) {
+  uint32_t i;
+
+  for (i = 0; i < gc->waitCount; i++) {
+    if (gk__gpuCullReady(scene, gc->waits[i]))
+      return true;
+  }
+
+  return false;
+}
+
+/* only moved instances are uploaded again */
+static
+_gk_hide
+void
+gk__gpuCullUpdate(GkSceneImpl * __restrict sceneImpl,
+                  GkGPUCull   * __restrict gc) {
+  GkBoxSoA      *soa;
+  GkGPUCullCand *cand;
+  float          inst[GK_INST_FLOATS];
+  uint32_t       i;
+
+  soa = &sceneImpl->cullBoxes;
+
+  gk__gpuCullUploadBoxes(gc, soa, soa->dirtyStart, soa->dirtyEnd);
+
+  if (soa->dirtyEnd <= soa->dirtyStart)
+    return;
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, gc->buffs[GK_GPUCULL_INST_IN]);
+
+  for (i = 0; i < gc->candCount; i++) {
+    cand = &gc->cands[i];
+    if (cand->slot < soa->dirtyStart || cand->slot >= soa->dirtyEnd)
+      continue;
+
+    gkInstanceData(cand->primInst->trans, inst);
+    glBufferSubData(GL_COPY_WRITE_BUFFER,
+                    GK_INST_STRIDE * i,
+                    GK_INST_STRIDE,
+                    inst);
+  }
+}
+
+void
+gkCullFrustumGPU(GkScene * __restrict scene, GkCamera * __restrict cam) {
+  GkSceneImpl *sceneImpl;
+  GkGPUCull   *gc;
+  GkPipeline  *prog;
+  uint32_t     layers, i;
+
+  sceneImpl = (GkSceneImpl *)scene;
+
+  if (!gk__gpuCullActive(scene)
+      || !(prog = gkBuiltinProg(GK_BUILTIN_PROG_CULL_FRUSTUM))) {
+    sceneImpl->gpuCullGen = 0;
+    return;
+  }
+
+  if (!(gc = sceneImpl->gpuCull)) {
+    gc = sceneImpl->gpuCull = calloc(1, sizeof(*gc));
+    glGenBuffers(GK_GPUCULL_BUFF_COUNT, gc->buffs);
+  }
+
+  layers = ~(scene->hiddenLayers | cam->hiddenLayers);
+
+  if (sceneImpl->gpuCullGen != gc->gen
+      || sceneImpl->gpuCullDirty
+      || gc->boxVersion != sceneImpl->cullBoxes.version
+      || gc->layers     != layers
+      || gk__gpuCullWaitDone(scene, gc)) {
+    gk__gpuCullBuild(scene, gc, layers);
+    gk__gpuCullUploadBoxes(gc, &sceneImpl->cullBoxes, 0, 0);
+  } else {
+    gk__gpuCullUpdate(sceneImpl, gc);
+  }
+
+  gkBoxSoAClean(&sceneImpl->cullBoxes);
+
+  if (gc->candCount == 0)
+    return;
+
+  /* commands which are not written by shader must draw nothing */
+  glBindBuffer(GL_COPY_WRITE_BUFFER, gc->buffs[GK_GPUCULL_CMDS]);
+  glClearBufferData(GL_COPY_WRITE_BUFFER,
+                    GL_R32UI,
+                    GL_RED_INTEGER,
+                    GL_UNSIGNED_INT,
+                    NULL);
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, gc->buffs[GK_GPUCULL_COUNTERS]);
+  glClearBufferData(GL_COPY_WRITE_BUFFER,
+                    GL_R32UI,
+                    GL_RED_INTEGER,
+                    GL_UNSIGNED_INT,
+                    NULL);
+
+  for (i = 0; i < GK_GPUCULL_BUFF_COUNT; i++)
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, gc->buffs[i]);
+
+  gkUseProgram(gkContextOf(scene), prog);
+
+  glUniform4fv(gkUniformLoc(prog, "uPlanes"), 6, cam->frustum.planes[0]);
+  glUniform1ui(gkUniformLoc(prog, "uDrawCount"), gc->candCount);
+  glUniform1ui(gkUniformLoc(prog, "uBoxStride"), gc->boxSize);
+
+  glDispatchCompute((gc->candCount + 63) / 64, 1, 1);
+
+  /* commands and instance data are read by draws */
+  glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
+
+void
+gkRenderGPUCulled(GkScene * __restrict scene) {
+  GkSceneImpl    *sceneImpl;
+  GkGPUCull      *gc;
+  GkGPUCullGroup *grp;
+  GkMegaLayout   *layout;
+  uint32_t        i;
+
+  sceneImpl = (GkSceneImpl *)scene;
+  if (!sceneImpl->gpuCullGen
+      || !(gc = sceneImpl->gpuCull)
+      || gc->candCount == 0)
+    return;
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, gc->buffs[GK_GPUCULL_CMDS]);
+
+  for (i = 0; i < gc->groupCount; i++) {
+    grp    = &gc->groups[i];
+    layout = grp->first->prim->mega->layout;
+
+    /* instance data of command k is at k, baseInstance selects it */
+    gkInstanceAttribs(layout->vao, gc->buffs[GK_GPUCULL_INST_OUT], 0, true);
+
+    sceneImpl->instanceCount   = grp->count;
+    sceneImpl->multiDrawCount  = grp->count;
+    sceneImpl->multiDrawOffset = sizeof(GkDrawElementsIndirect) * grp->start;
+
+    gkApplyMaterial(scene, grp->first);
+
+    gkInstanceAttribs(layout->vao, 0, 0, false);
+  }
+
+  sceneImpl->instanceCount   = 0;
+  sceneImpl->multiDrawCount  = 0;
+  sceneImpl->multiDrawOffset = 0;
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+#else
+
+void
+gkCullFrustumGPU(GkScene * __restrict scene, GkCamera * __restrict cam) {
+  ((GkSceneImpl *)scene)->gpuCullGen = 0;
+}
+
+void
+gkRenderGPUCulled(GkScene * __restrict scene) {
+}
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef frustum_gpu_h
+#define frustum_gpu_h
+
+#include "../../include/gk/gk.h"
+
+#if defined(GL_VERSION_4_3)
+#  define GK_GPU_CULLING 1
+#endif
+
+/*!
+ * @brief culls opaque prims which can be drawn with multi draw indirect
+ *        in a compute shader, must be called before gkCullFrustum() which
+ *        skips them while building render lists.
+ *
+ * boxes come from scene's box SoA and only changed ones are uploaded.
+ */
+void
+gkCullFrustumGPU(GkScene * __restrict scene, GkCamera * __restrict cam);
+
+/*!
+ * @brief draws prims which are culled by gkCullFrustumGPU(), one
+ *        glMultiDrawElementsIndirect per material and vertex format
+ */
+void
+gkRenderGPUCulled(GkScene * __restrict scene);
+
+#endif /* frustum_gpu_h */
@@ -0,0 +1,72 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../common.h"
+#include "occlusion.h"
+
+GK_EXPORT
+void
+gkSetOcclusionMode(GkScene * __restrict scene, GkOcclusionMode mode) {
+  GkSceneImpl *sceneImpl;
+
+  sceneImpl = (GkSceneImpl *)scene;
+  if (sceneImpl->occlusionMode == mode)
+    return;
+
+  /* free previous mode's state */
+  switch (sceneImpl->occlusionMode) {
+    case GK_OCCLUSION_CPU:
+      gkFreeOcclusionCPU(sceneImpl->occlusion);
+      break;
+    default:
+      break;
+  }
+
+  sceneImpl->occlusion     = NULL;
+  sceneImpl->occlusionMode = mode;
+}
+
+GK_EXPORT
+GkOcclusionMode
+gkOcclusionMode(GkScene * __restrict scene) {
+  return ((GkSceneImpl *)scene)->occlusionMode;
+}
+
+GK_EXPORT
+void
+gkCullOcclusion(GkScene  * __restrict scene,
+                GkCamera * __restrict cam) {
+  switch (((GkSceneImpl *)scene)->occlusionMode) {
+    case GK_OCCLUSION_CPU:
+      gkCullOcclusionCPU(scene, cam);
+      break;
+    case GK_OCCLUSION_GPU:
+      gkCullOcclusionGPU(scene, cam);
+      break;
+    default:
+      break;
+  }
+}
+
+GK_EXPORT
+void
+gkIssueOcclusionQueries(GkScene  * __restrict scene,
+                        GkCamera * __restrict cam) {
+  if (((GkSceneImpl *)scene)->occlusionMode == GK_OCCLUSION_GPU)
+    gkIssueOcclusionQueriesGPU(scene, cam);
+}
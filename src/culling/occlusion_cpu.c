@@ -0,0 +1,471 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../common.h"
+#include "occlusion.h"
+#include "box_soa.h"
+#include "../render/realtime/packet.h"
+#include "../../include/gk/vertex.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#if defined(GK_CULL_AVX) || defined(GK_CULL_SSE)
+#  include <emmintrin.h>
+#elif defined(GK_CULL_NEON)
+#  include <arm_neon.h>
+#endif
+
+/*
+ occluders' triangles are rasterized into a small depth buffer, then other
+ prims' boxes are tested against it. Occluders are marked by user, their
+ positions are read back from GPU once and kept on primitive. Depth is NDC z
+ in [0, 1].
+ */
+
+#define GK_OCC_W        256
+#define GK_OCC_H        128
+#define GK_OCC_TILE     8
+#define GK_OCC_TW       (GK_OCC_W / GK_OCC_TILE)
+#define GK_OCC_TH       (GK_OCC_H / GK_OCC_TILE)
+#define GK_OCC_MIN_W    1e-5f
+#define GK_OCC_MAX_TRIS 8192 /* detailed meshes are not used as occluders */
+
+typedef struct GkOcclusionCPU {
+  float depth[GK_OCC_W * GK_OCC_H];
+  float hizMax[GK_OCC_TW * GK_OCC_TH]; /* farthest depth in each tile */
+  float hizMin[GK_OCC_TW * GK_OCC_TH]; /* nearest depth in each tile  */
+} GkOcclusionCPU;
+
+typedef struct GkOccluderMesh {
+  float    *pos;     /* xyz, local space */
+  uint32_t *indices; /* triangles        */
+  uint32_t  vertCount;
+  uint32_t  indexCount;
+} GkOccluderMesh;
+
+static GkOccluderMesh gk__occ_none; /* prims which can't be occluders */
+
+/* point in depth buffer space, false if it is behind camera */
+static
+GK_INLINE
+bool
+gk__occProjectPoint(mat4 mvp, vec4 p, float * __restrict out) {
+  vec4 c;
+
+  glm_mat4_mulv(mvp, p, c);
+  if (c[3] < GK_OCC_MIN_W)
+    return false;
+
+  c[3]   = 1.0f / c[3];
+  out[0] = (c[0] * c[3] * 0.5f + 0.5f) * GK_OCC_W;
+  out[1] = (c[1] * c[3] * 0.5f + 0.5f) * GK_OCC_H;
+  out[2] =  c[2] * c[3] * 0.5f + 0.5f;
+
+  return true;
+}
+
+/* box corners in depth buffer space, false if a corner is behind camera */
+static
+_gk_hide
+bool
+gk__occProject(vec3 box[2], mat4 viewProj, vec3 out[8]) {
+  vec4    p;
+  int32_t i;
+
+  for (i = 0; i < 8; i++) {
+    p[0] = box[i & 1][0];
+    p[1] = box[(i >> 1) & 1][1];
+    p[2] = box[(i >> 2) & 1][2];
+    p[3] = 1.0f;
+
+    if (!gk__occProjectPoint(viewProj, p, out[i]))
+      return false;
+  }
+
+  return true;
+}
+
+/* positions and indices are only on GPU, read them back once */
+static
+_gk_hide
+GkOccluderMesh*
+gk__occMeshFor(GkPrimitive * __restrict prim) {
+  GkOccluderMesh    *mesh;
+  GkVertexInputBind *inp;
+  GkGPUAccessor     *acc;
+  uint8_t           *raw;
+  size_t             stride;
+  GLint              ibo;
+  uint32_t           i, count;
+
+  if (prim->occMesh)
+    return prim->occMesh != &gk__occ_none ? prim->occMesh : NULL;
+
+  prim->occMesh = &gk__occ_none;
+
+  for (inp = prim->vertex.firstInput; inp; inp = inp->next) {
+    if (strcmp(inp->input->name, "POSITION") == 0)
+      break;
+  }
+
+  if (!inp
+      || prim->mode != GL_TRIANGLES
+      || prim->count < 3
+      || prim->count / 3 > GK_OCC_MAX_TRIS
+      || !(acc = inp->input->accessor)
+      || !acc->buffer
+      || acc->itemType  != GL_FLOAT
+      || acc->itemCount <  3
+      || acc->count     == 0)
+    return NULL;
+
+  stride = acc->byteStride ? acc->byteStride : sizeof(float) * acc->itemCount;
+  count  = acc->count;
+
+  mesh             = calloc(1, sizeof(*mesh));
+  mesh->vertCount  = count;
+  mesh->indexCount = prim->count - prim->count % 3;
+  mesh->pos        = malloc(sizeof(float) * 3 * count);
+  mesh->indices    = malloc(sizeof(uint32_t) * mesh->indexCount);
+  raw              = malloc(stride * (count - 1) + sizeof(float) * 3);
+
+  glBindBuffer(GL_COPY_READ_BUFFER, acc->buffer->vbo);
+  glGetBufferSubData(GL_COPY_READ_BUFFER,
+                     acc->byteOffset,
+                     stride * (count - 1) + sizeof(float) * 3,
+                     raw);
+
+  for (i = 0; i < count; i++)
+    memcpy(mesh->pos + i * 3, raw + i * stride, sizeof(float) * 3);
+
+  free(raw);
+
+  if (prim->flags & GK_DRAW_ELEMENTS) {
+    /* index buffer is only known by primitive's VAO */
+    ibo = 0;
+    glBindVertexArray(prim->vao);
+    glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &ibo);
+    glBindVertexArray(0);
+
+    if (!ibo)
+      goto err;
+
+    glBindBuffer(GL_COPY_READ_BUFFER, ibo);
+    glGetBufferSubData(GL_COPY_READ_BUFFER,
+                       0,
+                       sizeof(uint32_t) * mesh->indexCount,
+                       mesh->indices);
+
+    for (i = 0; i < mesh->indexCount; i++) {
+      if (mesh->indices[i] >= count)
+        goto err;
+    }
+  } else {
+    if (mesh->indexCount > count)
+      goto err;
+
+    for (i = 0; i < mesh->indexCount; i++)
+      mesh->indices[i] = i;
+  }
+
+  return prim->occMesh = mesh;
+
+err:
+  free(mesh->pos);
+  free(mesh->indices);
+  free(mesh);
+  return NULL;
+}
+
+static
+GK_INLINE
+int32_t
+gk__occClamp(int32_t v, int32_t lo, int32_t hi) {
+  return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static
+GK_INLINE
+float
+gk__occEdge(float *a, float *b, float px, float py) {
+  return (b[0] - a[0]) * (py - a[1]) - (b[1] - a[1]) * (px - a[0]);
+}
+
+static
+_gk_hide
+void
+gk__occRasterTri(GkOcclusionCPU * __restrict occ,
+                 float          * __restrict a,
+                 float          * __restrict b,
+                 float          * __restrict c) {
+  float  *row, area, inv, w0, w1, w2, z, px, py;
+  int32_t x, y, x0, x1, y0, y1;
+
+  area = gk__occEdge(a, b, c[0], c[1]);
+  if (fabsf(area) < FLT_EPSILON)
+    return;
+
+  inv = 1.0f / area;
+
+  x0 = (int32_t)floorf(glm_min(a[0], glm_min(b[0], c[0])));
+  x1 = (int32_t)ceilf(glm_max(a[0], glm_max(b[0], c[0])));
+  y0 = (int32_t)floorf(glm_min(a[1], glm_min(b[1], c[1])));
+  y1 = (int32_t)ceilf(glm_max(a[1], glm_max(b[1], c[1])));
+
+  x0 = gk__occClamp(x0, 0, GK_OCC_W - 1);
+  y0 = gk__occClamp(y0, 0, GK_OCC_H - 1);
+  x1 = gk__occClamp(x1, 0, GK_OCC_W - 1);
+  y1 = gk__occClamp(y1, 0, GK_OCC_H - 1);
+
+  /* sample at pixel centers, weights are normalized so winding is ignored */
+  for (y = y0; y <= y1; y++) {
+    row = occ->depth + y * GK_OCC_W;
+    py  = y + 0.5f;
+
+    for (x = x0; x <= x1; x++) {
+      px = x + 0.5f;
+      w0 = gk__occEdge(b, c, px, py) * inv;
+      w1 = gk__occEdge(c, a, px, py) * inv;
+      w2 = gk__occEdge(a, b, px, py) * inv;
+
+      if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+        continue;
+
+      z = w0 * a[2] + w1 * b[2] + w2 * c[2];
+      if (z < row[x])
+        row[x] = z;
+    }
+  }
+}
+
+/* occluder triangles which cross near plane are skipped, it only makes
+   occlusion weaker */
+static
+_gk_hide
+void
+gk__occRasterMesh(GkOcclusionCPU * __restrict occ,
+                  GkOccluderMesh * __restrict mesh,
+                  mat4                        mvp) {
+  float    t[3][3];
+  vec4     p;
+  uint32_t i, k;
+
+  p[3] = 1.0f;
+
+  for (i = 0; i < mesh->indexCount; i += 3) {
+    for (k = 0; k < 3; k++) {
+      glm_vec3_copy(mesh->pos + mesh->indices[i + k] * 3, p);
+      if (!gk__occProjectPoint(mvp, p, t[k]))
+        break;
+    }
+
+    if (k == 3)
+      gk__occRasterTri(occ, t[0], t[1], t[2]);
+  }
+}
+
+static
+_gk_hide
+void
+gk__occBuildHiZ(GkOcclusionCPU * __restrict occ) {
+  float  *row, mx, mn;
+  int32_t tx, ty, x, y;
+
+  for (ty = 0; ty < GK_OCC_TH; ty++) {
+    for (tx = 0; tx < GK_OCC_TW; tx++) {
+      mx = 0.0f;
+      mn = 1.0f;
+      for (y = 0; y < GK_OCC_TILE; y++) {
+        row = occ->depth + (ty * GK_OCC_TILE + y) * GK_OCC_W + tx * GK_OCC_TILE;
+        for (x = 0; x < GK_OCC_TILE; x++) {
+          mx = glm_max(mx, row[x]);
+          mn = glm_min(mn, row[x]);
+        }
+      }
+
+      occ->hizMax[ty * GK_OCC_TW + tx] = mx;
+      occ->hizMin[ty * GK_OCC_TW + tx] = mn;
+    }
+  }
+}
+
+/* true if any pixel in [x0, x1] of row is farther than z */
+static
+GK_INLINE
+bool
+gk__occRowVisible(float * __restrict row, int32_t x0, int32_t x1, float z) {
+  int32_t x;
+
+  x = x0;
+
+#if defined(GK_CULL_AVX) || defined(GK_CULL_SSE)
+  {
+    __m128 vz;
+
+    vz = _mm_set1_ps(z);
+    for (; x + 4 <= x1 + 1; x += 4) {
+      if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), vz)))
+        return true;
+    }
+  }
+#elif defined(GK_CULL_NEON)
+  {
+    float32x4_t vz;
+    uint32x4_t  ge;
+
+    vz = vdupq_n_f32(z);
+    for (; x + 4 <= x1 + 1; x += 4) {
+      ge = vcgeq_f32(vld1q_f32(row + x), vz);
+      if (vgetq_lane_u32(ge, 0) | vgetq_lane_u32(ge, 1)
+          | vgetq_lane_u32(ge, 2) | vgetq_lane_u32(ge, 3))
+        return true;
+    }
+  }
+#endif
+
+  for (; x <= x1; x++) {
+    if (row[x] >= z)
+      return true;
+  }
+
+  return false;
+}
+
+static
+_gk_hide
+bool
+gk__occBoxVisible(GkOcclusionCPU * __restrict occ,
+                  vec3                        box[2],
+                  mat4                        viewProj) {
+  vec3    p[8];
+  float   zmin, minx, maxx, miny, maxy;
+  int32_t i, x0, x1, y0, y1, tx, ty, rx0, rx1, ry0, ry1, y;
+
+  /* crosses near plane */
+  if (!gk__occProject(box, viewProj, p))
+    return true;
+
+  minx = maxx = p[0][0];
+  miny = maxy = p[0][1];
+  zmin = p[0][2];
+
+  for (i = 1; i < 8; i++) {
+    minx = glm_min(minx, p[i][0]);
+    maxx = glm_max(maxx, p[i][0]);
+    miny = glm_min(miny, p[i][1]);
+    maxy = glm_max(maxy, p[i][1]);
+    zmin = glm_min(zmin, p[i][2]);
+  }
+
+  /* every touched pixel counts */
+  if (maxx < 0.0f || maxy < 0.0f || minx > GK_OCC_W || miny > GK_OCC_H)
+    return true;
+
+  x0 = gk__occClamp((int32_t)floorf(minx), 0, GK_OCC_W - 1);
+  y0 = gk__occClamp((int32_t)floorf(miny), 0, GK_OCC_H - 1);
+  x1 = gk__occClamp((int32_t)ceilf(maxx),  0, GK_OCC_W - 1);
+  y1 = gk__occClamp((int32_t)ceilf(maxy),  0, GK_OCC_H - 1);
+
+  for (ty = y0 / GK_OCC_TILE; ty <= y1 / GK_OCC_TILE; ty++) {
+    for (tx = x0 / GK_OCC_TILE; tx <= x1 / GK_OCC_TILE; tx++) {
+      /* whole tile is nearer than box */
+      if (occ->hizMax[ty * GK_OCC_TW + tx] < zmin)
+        continue;
+
+      /* box is nearer than whole tile */
+      if (occ->hizMin[ty * GK_OCC_TW + tx] >= zmin)
+        return true;
+
+      rx0 = gk__occClamp(x0, tx * GK_OCC_TILE, x1);
+      rx1 = gk__occClamp(tx * GK_OCC_TILE + GK_OCC_TILE - 1, x0, x1);
+      ry0 = gk__occClamp(y0, ty * GK_OCC_TILE, y1);
+      ry1 = gk__occClamp(ty * GK_OCC_TILE + GK_OCC_TILE - 1, y0, y1);
+
+      for (y = ry0; y <= ry1; y++) {
+        if (gk__occRowVisible(occ->depth + y * GK_OCC_W, rx0, rx1, zmin))
+          return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+void
+gkCullOcclusionCPU(GkScene  * __restrict scene,
+                   GkCamera * __restrict cam) {
+  GkSceneImpl    *sceneImpl;
+  GkOcclusionCPU *occ;
+  GkRenderList   *rl;
+  GkPrimInst     *primInst;
+  GkDrawPacket   *pkt;
+  GkOccluderMesh *mesh;
+  mat4            mvp;
+  size_t          i, occluders;
+  int32_t         j;
+
+  sceneImpl = (GkSceneImpl *)scene;
+  rl        = cam->frustum.opaque;
+
+  if (!rl || rl->count == 0)
+    return;
+
+  if (!(occ = sceneImpl->occlusion))
+    occ = sceneImpl->occlusion = malloc(sizeof(*occ));
+
+  for (j = 0; j < GK_OCC_W * GK_OCC_H; j++)
+    occ->depth[j] = 1.0f;
+
+  /* 1. rasterize occluders */
+  occluders = 0;
+  for (i = 0; i < rl->count; i++) {
+    primInst = rl->items[i];
+    if (!(primInst->geomInst->flags & GK_GEOMINST_FLAGS_OCCLUDER)
+        || primInst->hasSkin
+        || primInst->hasMorph
+        || !(mesh = gk__occMeshFor(primInst->prim)))
+      continue;
+
+    glm_mul(cam->viewProj, primInst->trans->world, mvp);
+    gk__occRasterMesh(occ, mesh, mvp);
+    occluders++;
+  }
+
+  if (occluders == 0)
+    return;
+
+  gk__occBuildHiZ(occ);
+
+  /* 2. test others */
+  for (i = 0; i < rl->count; i++) {
+    primInst = rl->items[i];
+    if ((primInst->geomInst->flags & GK_GEOMINST_FLAGS_OCCLUDER)
+        || gk__occBoxVisible(occ, primInst->bbox, cam->viewProj))
+      continue;
+
+    if ((pkt = primInst->packet))
+      pkt->occludedFrame = sceneImpl->frame;
+  }
+}
+
+void
+gkFreeOcclusionCPU(void * __restrict occ) {
+  free(occ);
+}
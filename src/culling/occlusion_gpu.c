@@ -0,0 +1,136 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../common.h"
+#include "occlusion.h"
+#include "../render/realtime/packet.h"
+#include "../default/def_prog.h"
+#include "../../include/gk/platform.h"
+#include "../../include/gk/prims/cube.h"
+#include "../../include/gk/gpu_state.h"
+
+#ifndef GL_ANY_SAMPLES_PASSED_CONSERVATIVE
+#  define GL_ANY_SAMPLES_PASSED_CONSERVATIVE 0x8D6A
+#endif
+
+/*
+ boxes of opaque prims are queried against depth buffer after they are
+ rendered, results are used in next frame without waiting: prims are hidden if
+ their box was hidden, drawn with conditional render if result is not ready.
+ */
+
+void
+gkCullOcclusionGPU(GkScene  * __restrict scene,
+                   GkCamera * __restrict cam) {
+  GkSceneImpl  *sceneImpl;
+  GkRenderList *rl;
+  GkDrawPacket *pkt;
+  GLuint        avail, passed;
+  size_t        i;
+
+  sceneImpl = (GkSceneImpl *)scene;
+  if (!(rl = cam->frustum.opaque))
+    return;
+
+  for (i = 0; i < rl->count; i++) {
+    /* only results of previous frame are valid for this view */
+    if (!(pkt = rl->items[i]->packet)
+        || !pkt->query
+        || pkt->queryFrame + 1 != sceneImpl->frame)
+      continue;
+
+    avail = GL_FALSE;
+    glGetQueryObjectuiv(pkt->query, GL_QUERY_RESULT_AVAILABLE, &avail);
+
+    if (!avail) {
+      pkt->condFrame = sceneImpl->frame;
+      continue;
+    }
+
+    passed = GL_TRUE;
+    glGetQueryObjectuiv(pkt->query, GL_QUERY_RESULT, &passed);
+
+    if (!passed)
+      pkt->occludedFrame = sceneImpl->frame;
+  }
+}
+
+void
+gkIssueOcclusionQueriesGPU(GkScene  * __restrict scene,
+                           GkCamera * __restrict cam) {
+  GkSceneImpl  *sceneImpl;
+  GkContext    *ctx;
+  GkRenderList *rl;
+  GkPrimInst   *primInst;
+  GkDrawPacket *pkt;
+  GkPipeline   *prog;
+  GLenum        target;
+  vec3          eye;
+  size_t        i;
+
+  sceneImpl = (GkSceneImpl *)scene;
+  if (!(rl = cam->frustum.opaque) || rl->count == 0)
+    return;
+
+  target = gkPlatfomInfo(GK_PLI_CONSERVATIVE_QUERY)
+             ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED;
+
+  ctx  = gkContextOf(scene);
+  prog = gk_prog_cube();
+
+  gkPushState(ctx);
+
+  gkUseProgram(ctx, prog);
+  gkDepthMask(ctx, GL_FALSE);
+  gkDisableCullFace(ctx);
+  glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+  /* box faces may lie on prim's own surfaces, pull them a bit towards eye */
+  gkDepthFunc(ctx, GL_LEQUAL);
+  glEnable(GL_POLYGON_OFFSET_FILL);
+  glPolygonOffset(-1.0f, -1.0f);
+
+  glm_vec3_copy(cam->world[3], eye);
+
+  for (i = 0; i < rl->count; i++) {
+    primInst = rl->items[i];
+    if (!(pkt = primInst->packet))
+      continue;
+
+    /* box contains eye, faces behind could be hidden */
+    if (glm_aabb_point(primInst->bbox, eye)) {
+      pkt->queryFrame = 0;
+      continue;
+    }
+
+    if (!pkt->query)
+      glGenQueries(1, &pkt->query);
+
+    glBeginQuery(target, pkt->query);
+    gkDrawBBoxFaces(scene, prog, primInst->bbox);
+    glEndQuery(target);
+
+    pkt->queryFrame = sceneImpl->frame;
+  }
+
+  glPolygonOffset(0.0f, 0.0f);
+  glDisable(GL_POLYGON_OFFSET_FILL);
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+  gkPopState(ctx);
+}
@@ -18,6 +18,7 @@
 
 #include "../common.h"
 #include "../../include/gk/opt.h"
+#include "../render/realtime/packet.h"
 
 vec3 gk__light_dir = {0.0f, 0.0f, -1.0f};
 vec3 gk__light_up  = {0.0f, 1.0f,  0.0f};
@@ -25,13 +26,28 @@ vec3 gk__light_up  = {0.0f, 1.0f,  0.0f};
 uintptr_t GK_OPTIONS[] =
 {
   (uintptr_t)&gk__light_dir,
-  (uintptr_t)&gk__light_up
+  (uintptr_t)&gk__light_up,
+  (uintptr_t)NULL,
+  (uintptr_t)0, /* GK_SHADER_COMPILE_SYNC */
+  (uintptr_t)0, /* no job workers         */
+  (uintptr_t)1, /* GK_SORT_STATE          */
+  (uintptr_t)3, /* GK_SORT_BACK_TO_FRONT  */
+  (uintptr_t)1, /* GK_OPT_INSTANCING      */
+  (uintptr_t)0, /* GK_OPT_MULTI_DRAW      */
+  (uintptr_t)0, /* GK_OPT_GPU_CULLING     */
+  (uintptr_t)1  /* GK_OPT_TRANSFORM_UBO   */
 };
 
 GK_EXPORT
 void
 gk_opt_set(GkOption option, uintptr_t value) {
+  if (GK_OPTIONS[option] == value)
+    return;
+
   GK_OPTIONS[option] = value;
+
+  /* options may select shader variants e.g. GK_OPT_TRANSFORM_UBO */
+  gkInvalidatePipelines();
 }
 
 GK_EXPORT
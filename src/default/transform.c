@@ -22,14 +22,13 @@
 
 GkTransformImpl gkdef_idmat = {
   .pub = {
-    GLM_MAT4_IDENTITY_INIT,
-    GLM_MAT4_IDENTITY_INIT,
+    gkdef_idmat.ownLocal,
+    gkdef_idmat.ownWorld,
     GK_TRANSF_LOCAL_ISVALID,
     NULL
   },
-  0,
-  0,
-  NULL
+  .ownLocal = GLM_MAT4_IDENTITY_INIT,
+  .ownWorld = GLM_MAT4_IDENTITY_INIT
 };
 
 GkTransform *
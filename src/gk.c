@@ -19,6 +19,7 @@
 #include "common.h"
 #include "../include/gk/context.h"
 #include "state/gpu.h"
+#include "render/realtime/packet.h"
 
 #include <ds/forward-list.h>
 #include <string.h>
@@ -119,6 +120,56 @@ gkMakeInstance(GkGeometry *geom) {
   return inst;
 }
 
+static
+void
+gkFreeInstanceBuffer(GkGpuBuffer *buff) {
+  if (!buff)
+    return;
+
+  glDeleteBuffers(1, &buff->vbo);
+  free(buff);
+}
+
+GK_EXPORT
+void
+gkFreeInstance(GkGeometryInst *inst) {
+  GkGeometry     *geom;
+  GkGeometryInst *it;
+  GkDrawPacket   *pkt;
+  int32_t         i;
+
+  if ((geom = inst->geom) && geom->instances) {
+    if ((it = geom->instances->instance) == inst) {
+      geom->instances->instance = inst->next;
+    } else {
+      while (it && it->next != inst)
+        it = it->next;
+
+      if (it)
+        it->next = inst->next;
+    }
+
+    geom->instances->instanceCount--;
+  }
+
+  for (i = 0; i < inst->primc; i++) {
+    if (!(pkt = inst->prims[i].packet))
+      continue;
+
+    if (pkt->query)
+      glDeleteQueries(1, &pkt->query);
+
+    free(pkt);
+  }
+
+  gkFreeInstanceBuffer(inst->uboJoints);
+  gkFreeInstanceBuffer(inst->uboTargetWeights);
+
+  free(inst->joints);
+  free(inst->jointsToDraw);
+  free(inst);
+}
+
 void
 gkReshape(GkScene *scene, GkRect rect) {
   if (!scene->camera)
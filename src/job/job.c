@@ -0,0 +1,423 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "job.h"
+#include "../../include/gk/opt.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef GK_JOB_NO_THREADS
+#  include <pthread.h>
+#  include <sched.h>
+#  define gk__atomicAdd(P, V) atomic_fetch_add(P, V)
+#  define gk__atomicSub(P, V) atomic_fetch_sub(P, V)
+#  define gk__atomicGet(P)    atomic_load(P)
+#  define gk__atomicSet(P, V) atomic_store(P, V)
+#else
+#  define gk__atomicAdd(P, V) ((*(P) += (V)) - (V))
+#  define gk__atomicSub(P, V) ((*(P) -= (V)) + (V))
+#  define gk__atomicGet(P)    (*(P))
+#  define gk__atomicSet(P, V) (*(P) = (V))
+#endif
+
+#define GK_JOB_QUEUE_MASK (GK_JOB_QUEUE_SIZE - 1)
+#define GK_JOB_SPIN       64
+#define GK_JOB_STACK_JOBS 64
+
+static
+void
+gk__jobExecute(GkJob * __restrict job);
+
+static
+void
+gk__jobPush(GkJob * __restrict job);
+
+static
+GkJob*
+gk__jobNext(void);
+
+#ifndef GK_JOB_NO_THREADS
+
+typedef struct GkJobQueue {
+  pthread_mutex_t lock;
+  uint32_t        top;    /* thieves take from here */
+  uint32_t        bottom; /* owner pushes and pops here */
+  GkJob          *jobs[GK_JOB_QUEUE_SIZE];
+} GkJobQueue;
+
+typedef struct GkJobSystem {
+  pthread_t       threads[GK_JOB_MAX_WORKERS];
+  GkJobQueue      queues[GK_JOB_MAX_WORKERS + 1]; /* last: other threads */
+  pthread_mutex_t sleepLock;
+  pthread_cond_t  sleepCond;
+  atomic_int      pending;
+  atomic_bool     running;
+  uint32_t        nworkers;
+} GkJobSystem;
+
+static GkJobSystem            *gk__jobs;
+static _Thread_local int32_t   gk__jobWorker = -1;
+
+static
+GK_INLINE
+uint32_t
+gk__jobSelf(void) {
+  return gk__jobWorker < 0 ? gk__jobs->nworkers : (uint32_t)gk__jobWorker;
+}
+
+static
+void*
+gk__jobWorkerMain(void *arg) {
+  GkJobSystem *sys;
+  GkJob       *job;
+  uint32_t     spin;
+
+  sys           = gk__jobs;
+  gk__jobWorker = (int32_t)(intptr_t)arg;
+  spin          = 0;
+
+  while (atomic_load(&sys->running)) {
+    if ((job = gk__jobNext())) {
+      gk__jobExecute(job);
+      spin = 0;
+      continue;
+    }
+
+    if (++spin < GK_JOB_SPIN) {
+      sched_yield();
+      continue;
+    }
+
+    pthread_mutex_lock(&sys->sleepLock);
+    while (atomic_load(&sys->running) && atomic_load(&sys->pending) == 0)
+      pthread_cond_wait(&sys->sleepCond, &sys->sleepLock);
+    pthread_mutex_unlock(&sys->sleepLock);
+
+    spin = 0;
+  }
+
+  return NULL;
+}
+
+static
+void
+gk__jobStart(uint32_t nworkers) {
+  GkJobSystem *sys;
+  uint32_t     i;
+
+  sys           = calloc(1, sizeof(*sys));
+  sys->nworkers = nworkers;
+  gk__jobs      = sys;
+
+  for (i = 0; i <= nworkers; i++)
+    pthread_mutex_init(&sys->queues[i].lock, NULL);
+
+  pthread_mutex_init(&sys->sleepLock, NULL);
+  pthread_cond_init(&sys->sleepCond, NULL);
+  atomic_store(&sys->pending, 0);
+  atomic_store(&sys->running, true);
+
+  for (i = 0; i < nworkers; i++)
+    pthread_create(&sys->threads[i], NULL, gk__jobWorkerMain, (void *)(intptr_t)i);
+}
+
+void
+gkJobShutdown(void) {
+  GkJobSystem *sys;
+  uint32_t     i;
+
+  if (!(sys = gk__jobs))
+    return;
+
+  pthread_mutex_lock(&sys->sleepLock);
+  atomic_store(&sys->running, false);
+  pthread_cond_broadcast(&sys->sleepCond);
+  pthread_mutex_unlock(&sys->sleepLock);
+
+  for (i = 0; i < sys->nworkers; i++)
+    pthread_join(sys->threads[i], NULL);
+
+  for (i = 0; i <= sys->nworkers; i++)
+    pthread_mutex_destroy(&sys->queues[i].lock);
+
+  pthread_mutex_destroy(&sys->sleepLock);
+  pthread_cond_destroy(&sys->sleepCond);
+
+  free(sys);
+  gk__jobs = NULL;
+}
+
+uint32_t
+gkJobWorkerCount(void) {
+  uintptr_t n;
+
+  n = gk_opt(GK_OPT_JOB_WORKERS);
+  if (n > GK_JOB_MAX_WORKERS)
+    n = GK_JOB_MAX_WORKERS;
+
+  if (gk__jobs && gk__jobs->nworkers != n)
+    gkJobShutdown();
+
+  if (!gk__jobs && n > 0)
+    gk__jobStart((uint32_t)n);
+
+  return (uint32_t)n;
+}
+
+static
+void
+gk__jobPush(GkJob * __restrict job) {
+  GkJobSystem *sys;
+  GkJobQueue  *q;
+
+  if (!(sys = gk__jobs)) {
+    gk__jobExecute(job);
+    return;
+  }
+
+  q = &sys->queues[gk__jobSelf()];
+
+  pthread_mutex_lock(&q->lock);
+  if (q->bottom - q->top == GK_JOB_QUEUE_SIZE) {
+    pthread_mutex_unlock(&q->lock);
+
+    /* queue is full, run it now */
+    gk__jobExecute(job);
+    return;
+  }
+
+  q->jobs[q->bottom & GK_JOB_QUEUE_MASK] = job;
+  q->bottom++;
+  pthread_mutex_unlock(&q->lock);
+
+  atomic_fetch_add(&sys->pending, 1);
+
+  pthread_mutex_lock(&sys->sleepLock);
+  pthread_cond_signal(&sys->sleepCond);
+  pthread_mutex_unlock(&sys->sleepLock);
+}
+
+static
+GkJob*
+gk__jobPop(GkJobQueue * __restrict q, bool steal) {
+  GkJob *job;
+
+  job = NULL;
+
+  pthread_mutex_lock(&q->lock);
+  if (q->bottom != q->top) {
+    if (steal) {
+      job = q->jobs[q->top & GK_JOB_QUEUE_MASK];
+      q->top++;
+    } else {
+      q->bottom--;
+      job = q->jobs[q->bottom & GK_JOB_QUEUE_MASK];
+    }
+  }
+  pthread_mutex_unlock(&q->lock);
+
+  if (job)
+    atomic_fetch_sub(&gk__jobs->pending, 1);
+
+  return job;
+}
+
+static
+GkJob*
+gk__jobNext(void) {
+  GkJobSystem *sys;
+  GkJob       *job;
+  uint32_t     self, nq, i;
+
+  if (!(sys = gk__jobs) || atomic_load(&sys->pending) == 0)
+    return NULL;
+
+  self = gk__jobSelf();
+  nq   = sys->nworkers + 1;
+
+  if ((job = gk__jobPop(&sys->queues[self], false)))
+    return job;
+
+  for (i = 1; i < nq; i++) {
+    if ((job = gk__jobPop(&sys->queues[(self + i) % nq], true)))
+      return job;
+  }
+
+  return NULL;
+}
+
+#else /* GK_JOB_NO_THREADS */
+
+uint32_t
+gkJobWorkerCount(void) {
+  return 0;
+}
+
+void
+gkJobShutdown(void) { }
+
+static
+void
+gk__jobPush(GkJob * __restrict job) {
+  gk__jobExecute(job);
+}
+
+static
+GkJob*
+gk__jobNext(void) {
+  return NULL;
+}
+
+#endif
+
+static
+void
+gk__jobFinish(GkJob * __restrict job) {
+  GkJob   *parent, *deps[GK_JOB_MAX_DEPENDENTS];
+  uint32_t i, n;
+
+  /* waiter may release job as soon as counter is zero, copy links first */
+  parent = job->parent;
+  n      = job->ndependents;
+  memcpy(deps, job->dependents, n * sizeof(*deps));
+
+  if (gk__atomicSub(&job->unfinished, 1) != 1)
+    return;
+
+  for (i = 0; i < n; i++) {
+    if (gk__atomicSub(&deps[i]->pendingDeps, 1) == 1)
+      gk__jobPush(deps[i]);
+  }
+
+  if (parent)
+    gk__jobFinish(parent);
+}
+
+static
+void
+gk__jobExecute(GkJob * __restrict job) {
+  if (job->fn)
+    job->fn(job->data, job->begin, job->end);
+
+  gk__jobFinish(job);
+}
+
+void
+gkJobInit(GkJob   * __restrict job,
+          GkJob   * __restrict parent,
+          GkJobFn              fn,
+          void    * __restrict data,
+          uint32_t             begin,
+          uint32_t             end) {
+  job->parent      = parent;
+  job->fn          = fn;
+  job->data        = data;
+  job->begin       = begin;
+  job->end         = end;
+  job->ndependents = 0;
+
+  /* submission holds one pending dependency, see gkJobSubmit() */
+  gk__atomicSet(&job->unfinished,  1);
+  gk__atomicSet(&job->pendingDeps, 1);
+
+  if (parent)
+    (void)gk__atomicAdd(&parent->unfinished, 1);
+}
+
+void
+gkJobDepends(GkJob * __restrict job, GkJob * __restrict dep) {
+  if (dep->ndependents == GK_JOB_MAX_DEPENDENTS) {
+    /* no room, wait it instead */
+    gkJobWait(dep);
+    return;
+  }
+
+  (void)gk__atomicAdd(&job->pendingDeps, 1);
+  dep->dependents[dep->ndependents++] = job;
+}
+
+void
+gkJobSubmit(GkJob * __restrict job) {
+  /* last one of submission and dependencies pushes job */
+  if (gk__atomicSub(&job->pendingDeps, 1) == 1)
+    gk__jobPush(job);
+}
+
+void
+gkJobWait(GkJob * __restrict job) {
+  GkJob *other;
+
+  while (gk__atomicGet(&job->unfinished) > 0) {
+    if ((other = gk__jobNext())) {
+      gk__jobExecute(other);
+      continue;
+    }
+
+#ifndef GK_JOB_NO_THREADS
+    sched_yield();
+#endif
+  }
+}
+
+void
+gkJobParallelFor(uint32_t             count,
+                 uint32_t             grain,
+                 GkJobFn              fn,
+                 void    * __restrict data) {
+  GkJob     root, stackJobs[GK_JOB_STACK_JOBS], *jobs;
+  uint32_t  nranges, i, begin, end;
+
+  if (count == 0)
+    return;
+
+  if (grain == 0)
+    grain = 1;
+
+  nranges = (count + grain - 1) / grain;
+
+  /* same ranges as threaded path */
+  if (nranges == 1 || gkJobWorkerCount() == 0) {
+    for (begin = 0; begin < count; begin += grain) {
+      end = begin + grain < count ? begin + grain : count;
+      fn(data, begin, end);
+    }
+    return;
+  }
+
+  jobs = stackJobs;
+  if (nranges > GK_JOB_STACK_JOBS)
+    jobs = malloc(sizeof(*jobs) * nranges);
+
+  gkJobInit(&root, NULL, NULL, NULL, 0, 0);
+
+  for (i = 0; i < nranges; i++) {
+    begin = i * grain;
+    end   = begin + grain < count ? begin + grain : count;
+
+    gkJobInit(&jobs[i], &root, fn, data, begin, end);
+    gkJobSubmit(&jobs[i]);
+  }
+
+  /* root has no work, drop its own count and help until children finish */
+  gk__jobFinish(&root);
+  gkJobWait(&root);
+
+  if (jobs != stackJobs)
+    free(jobs);
+}
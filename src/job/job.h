@@ -0,0 +1,97 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef gk_job_h
+#define gk_job_h
+
+#include "../common.h"
+
+/*
+ small work-stealing job system for scene update. Each worker owns a deque,
+ it pushes and pops from bottom while others steal from top. Thread which
+ waits for a job also executes jobs so nested parallel-for does not block.
+
+ Worker count comes from GK_OPT_JOB_WORKERS, 0 runs everything on calling
+ thread like before.
+ */
+
+#define GK_JOB_MAX_WORKERS    64
+#define GK_JOB_MAX_DEPENDENTS 8
+#define GK_JOB_QUEUE_SIZE     1024 /* per worker, must be power of two */
+
+#if defined(_WIN32) || defined(GK_JOB_NO_THREADS)
+#  undef  GK_JOB_NO_THREADS
+#  define GK_JOB_NO_THREADS
+typedef int gk_atomic_int;
+#else
+#  include <stdatomic.h>
+typedef atomic_int gk_atomic_int;
+#endif
+
+typedef void (*GkJobFn)(void *data, uint32_t begin, uint32_t end);
+
+typedef struct GkJob {
+  struct GkJob *parent;
+  struct GkJob *dependents[GK_JOB_MAX_DEPENDENTS];
+  GkJobFn       fn;
+  void         *data;
+  uint32_t      begin;
+  uint32_t      end;
+  uint32_t      ndependents;
+  gk_atomic_int unfinished;  /* itself and children */
+  gk_atomic_int pendingDeps; /* dependencies which are not finished yet */
+} GkJob;
+
+/* number of worker threads, starts or resizes pool by option */
+uint32_t
+gkJobWorkerCount(void);
+
+/* parent waits for job too, fn may be NULL to group jobs */
+void
+gkJobInit(GkJob   * __restrict job,
+          GkJob   * __restrict parent,
+          GkJobFn              fn,
+          void    * __restrict data,
+          uint32_t             begin,
+          uint32_t             end);
+
+/* job runs after dep is finished, call before submitting both */
+void
+gkJobDepends(GkJob * __restrict job, GkJob * __restrict dep);
+
+void
+gkJobSubmit(GkJob * __restrict job);
+
+/* executes other jobs while waiting */
+void
+gkJobWait(GkJob * __restrict job);
+
+/*
+ calls fn over [0, count) in ranges of grain items. Ranges do not depend on
+ worker count and scheduling, so writes to per-range outputs stay same.
+ */
+void
+gkJobParallelFor(uint32_t             count,
+                 uint32_t             grain,
+                 GkJobFn              fn,
+                 void    * __restrict data);
+
+void
+gkJobShutdown(void);
+
+#endif /* gk_job_h */
@@ -21,6 +21,7 @@
 #include "common.h"
 
 #include "shader/shader.h"
+#include "shader/cmn_material.h"
 #include "program/program.h"
 #include "program/vertex_input.h"
 
@@ -41,11 +42,13 @@ gk__init() {
   gk_vertinp_init();
   gk_shaders_init();
   gk_prog_init();
+  gk_cmnmat_init();
 }
 
 void
 GK_DESTRUCTOR
 gk__cleanup() {
+  gk_cmnmat_deinit();
   gk_prog_deinit();
   gk_shaders_deinit();
   gk_vertinp_deinit();
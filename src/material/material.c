@@ -82,3 +82,9 @@ gkMaterialNewSpecGloss() {
          sizeof(*specGloss));
   return specGloss;
 }
+
+GK_EXPORT
+void
+gkInvalidateMaterial(GkMaterial * __restrict mat) {
+  mat->version++;
+}
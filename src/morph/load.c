@@ -163,10 +163,7 @@ void
 gkMakeInstanceMorph(struct GkScene         * __restrict scene,
                     struct GkNode          * __restrict node,
                     struct GkInstanceMorph * __restrict morphInst) {
-  GkSceneImpl *sceneImpl;
-
-  sceneImpl     = (GkSceneImpl *)scene;
   node->morpher = morphInst;
 
-  flist_sp_insert(&sceneImpl->instMorphs, node);
+  gkNodeCompAdd(scene, node, GK_NODE_COMP_MORPHED, morphInst);
 }
@@ -22,6 +22,9 @@
 #include "../include/gk/opt.h"
 #include "bbox/scene_bbox.h"
 #include "anim/animatable.h"
+#include "transform/store.h"
+#include "node/components.h"
+#include "job/job.h"
 
 #include <ds/hash.h>
 #include <string.h>
@@ -38,54 +41,229 @@ static
 void
 gkPrepInstSkin(GkScene * __restrict scene);
 
+static
+void
+gkFreeNodeTree(GkScene * __restrict scene,
+               GkNode  * __restrict node);
+
+GK_INLINE
+void
+gkNodePageAddAvail(GkSceneImpl * __restrict sceneImpl,
+                   GkNodePage  * __restrict np) {
+  np->prevAvail = NULL;
+  np->nextAvail = sceneImpl->availPages;
+
+  if (sceneImpl->availPages)
+    sceneImpl->availPages->prevAvail = np;
+
+  sceneImpl->availPages = np;
+}
+
+GK_INLINE
+void
+gkNodePageRemoveAvail(GkSceneImpl * __restrict sceneImpl,
+                      GkNodePage  * __restrict np) {
+  if (np->prevAvail)
+    np->prevAvail->nextAvail = np->nextAvail;
+  else
+    sceneImpl->availPages = np->nextAvail;
+
+  if (np->nextAvail)
+    np->nextAvail->prevAvail = np->prevAvail;
+
+  np->prevAvail = np->nextAvail = NULL;
+}
+
+static
+GkNodePage*
+gkNewNodePage(GkSceneImpl * __restrict sceneImpl) {
+  GkNodePage *np;
+  uint32_t    i;
+
+  np       = calloc(1, sizeof(*np) + gk_nodesPerPage * sizeof(GkNodeImpl));
+  np->size = gk_nodesPerPage;
+  np->next = sceneImpl->lastPage;
+
+  if (sceneImpl->lastPage)
+    sceneImpl->lastPage->prev = np;
+
+  sceneImpl->lastPage = np;
+
+  /* free list keeps slot order, lower slots are used first */
+  for (i = 0; i < np->size; i++) {
+    np->nodes[i].page     = np;
+    np->nodes[i].nextFree = i + 1 < np->size ? &np->nodes[i + 1] : NULL;
+  }
+
+  np->freeList = &np->nodes[0];
+  gkNodePageAddAvail(sceneImpl, np);
+
+  return np;
+}
+
 GkNode*
 gkAllocNode(struct GkScene * __restrict scene) {
   GkNodePage  *np;
   GkSceneImpl *sceneImpl;
-  GkNode      *node;
-  size_t       i;
+  GkNodeImpl  *nodeImpl;
 
   sceneImpl = (GkSceneImpl *)scene;
-  np        = sceneImpl->lastPage;
 
-  if (!np || np->size == np->count)
-    goto nw;
+  if (!(np = sceneImpl->availPages))
+    np = gkNewNodePage(sceneImpl);
 
-  for (i = 0; i < gk_nodesPerPage; i++) {
-    node = &np->nodes[i];
-    if (node->flags & GK_NODEF_NODE)
-      continue;
+  nodeImpl     = np->freeList;
+  np->freeList = nodeImpl->nextFree;
+  np->count++;
+
+  if (!np->freeList)
+    gkNodePageRemoveAvail(sceneImpl, np);
 
-    node->flags |= GK_NODEF_NODE;
-    np->count++;
-    return node;
+  if (sceneImpl->liveCount == sceneImpl->liveSize) {
+    sceneImpl->liveSize  = sceneImpl->liveSize ? sceneImpl->liveSize * 2 : 64;
+    sceneImpl->liveNodes = realloc(sceneImpl->liveNodes,
+                                   sizeof(GkNode *) * sceneImpl->liveSize);
   }
 
-nw:
-  np        = calloc(1, sizeof(*np) + gk_nodesPerPage * sizeof(GkNode));
-  np->size  = gk_nodesPerPage;
-  np->next  = sceneImpl->lastPage;
-  np->count = 1;
+  nodeImpl->nextFree  = NULL;
+  nodeImpl->liveIndex = sceneImpl->liveCount;
+  sceneImpl->liveNodes[sceneImpl->liveCount++] = &nodeImpl->pub;
 
-  sceneImpl->lastPage = np;
-  if (!sceneImpl->nodePages)
-    sceneImpl->nodePages = np;
+  nodeImpl->pub.flags |= GK_NODEF_NODE;
+  nodeImpl->pub.anim   = gkAnimatable(&nodeImpl->pub);
+
+  sceneImpl->transStore.dirty = true;
+
+  return &nodeImpl->pub;
+}
+
+static
+void
+gkFreeNodeGeom(GkScene        * __restrict scene,
+               GkGeometryInst * __restrict geomInst) {
+  GkSceneImpl *sceneImpl;
+
+  sceneImpl = (GkSceneImpl *)scene;
+
+  /* scene bounds and center are kept in BVH, see gkUpdateSceneBounds() */
+  gkBVHRemove(&sceneImpl->bvh, geomInst);
+  gkBoxSoARemove(&sceneImpl->cullBoxes, geomInst);
+
+  gkFreeInstance(geomInst);
+}
+
+static
+void
+gkFreeNodeContent(GkScene * __restrict scene,
+                  GkNode  * __restrict node) {
+  GkSceneImpl *sceneImpl;
+  GkNodeImpl  *nodeImpl, *last;
+  GkNodePage  *np;
+  FListItem   *item;
+  uint32_t     i;
+
+  sceneImpl = (GkSceneImpl *)scene;
+  nodeImpl  = (GkNodeImpl *)node;
+  np        = nodeImpl->page;
+
+  /* instances of same geometry are also linked with next, they may belong
+     to other nodes so only node's own instance is released */
+  if (node->geom)
+    gkFreeNodeGeom(scene, node->geom);
+
+  if (node->flags & GK_NODEF_TRANSF_DIRTY) {
+    for (i = 0; i < sceneImpl->dirtyCount; i++) {
+      if (sceneImpl->dirtyNodes[i] == node) {
+        sceneImpl->dirtyNodes[i] = sceneImpl->dirtyNodes[--sceneImpl->dirtyCount];
+        break;
+      }
+    }
+  }
+
+  if (node->anim) {
+    while ((item = node->anim->animations->first))
+      gkRemoveAnimation(node, item->data);
+
+    flist_destroy(node->anim->animations);
+    free(node->anim);
+  }
+
+  gkNodeRemoveComps(scene, node);
+
+  if (node->trans && (node->flags & GK_NODEF_HAVE_TRANSFORM))
+    gkFreeTransform(scene, node->trans);
+
+  /* swap with last live node */
+  last = (GkNodeImpl *)sceneImpl->liveNodes[--sceneImpl->liveCount];
+  sceneImpl->liveNodes[nodeImpl->liveIndex] = &last->pub;
+  last->liveIndex = nodeImpl->liveIndex;
+
+  memset(&nodeImpl->pub, 0, sizeof(nodeImpl->pub));
+
+  if (!np->freeList)
+    gkNodePageAddAvail(sceneImpl, np);
 
-  node = &np->nodes[0];
-  node->flags |= GK_NODEF_NODE;
+  nodeImpl->nextFree = np->freeList;
+  np->freeList       = nodeImpl;
 
-  node->anim = gkAnimatable(node);
+  /* release empty pages but keep one to avoid alloc/free thrashing */
+  if (--np->count == 0 && (np->prev || np->next)) {
+    gkNodePageRemoveAvail(sceneImpl, np);
 
-  return node;
+    if (np->prev)
+      np->prev->next = np->next;
+    else
+      sceneImpl->lastPage = np->next;
+
+    if (np->next)
+      np->next->prev = np->prev;
+
+    free(np);
+  }
+}
+
+static
+void
+gkFreeNodeTree(GkScene * __restrict scene,
+               GkNode  * __restrict node) {
+  GkNode *chld, *next;
+
+  /* children first, they may share transform of this node */
+  chld = node->chld;
+  while (chld) {
+    next = chld->next;
+    gkFreeNodeTree(scene, chld);
+    chld = next;
+  }
+
+  gkFreeNodeContent(scene, node);
 }
 
 GK_EXPORT
 void
 gkFreeNode(GkScene * __restrict scene,
            GkNode  * __restrict node) {
-  node->flags &= ~GK_NODEF_NODE;
+  GkNode **it;
+
+  if (!node || !(node->flags & GK_NODEF_NODE))
+    return;
+
+  /* detach from hierarchy */
+  if (node->parent) {
+    for (it = &node->parent->chld; *it; it = &(*it)->next) {
+      if (*it == node) {
+        *it = node->next;
+        break;
+      }
+    }
+  } else if (scene->rootNode == node) {
+    scene->rootNode = NULL;
+  }
+
+  gkFreeNodeTree(scene, node);
+  gkUpdateSceneBounds(scene);
 
-  /* todo: free node and all child nodes */
+  ((GkSceneImpl *)scene)->transStore.dirty = true;
 }
 
 void
@@ -101,119 +279,163 @@ gkMakeNodeTransform(GkScene * __restrict scene,
   node->flags |= GK_NODEF_HAVE_TRANSFORM;
 }
 
+/* boxes and center of instance, touches only the instance */
 static
 void
-gkPrepareNode(GkScene * __restrict scene,
-              GkNode  * __restrict parentNode,
-              GkNode  * __restrict node) {
+gkPrepareGeomInst(GkGeometryInst * __restrict geomInst,
+                  GkTransform    * __restrict tr) {
+  GkPrimInst *prims;
+  int32_t     i, primc;
+
+  geomInst->trans = tr;
+  glm_aabb_transform(geomInst->geom->bbox, tr->world, geomInst->bbox);
+
+  prims = geomInst->prims;
+  primc = geomInst->primc;
+
+  for (i = 0; i < primc; i++) {
+    glm_aabb_transform(prims[i].prim->bbox, tr->world, prims[i].bbox);
+    prims[i].trans = tr;
+  }
+
+  glm_mat4_mulv3(tr->world,
+                 geomInst->geom->center,
+                 1.0f,
+                 geomInst->center);
+}
+
+/*
+ updates bboxes and lights after world matrix is ready, final transforms
+ of geometries are computed after culling only for visible ones. If
+ headReady is true then node->geom is already prepared by a job.
+ */
+static
+void
+gkCommitNodeContent(GkScene     * __restrict scene,
+                    GkNode      * __restrict node,
+                    GkTransform * __restrict tr,
+                    bool                     headReady) {
   GkSceneImpl     *sceneImpl;
   GkCameraImpl    *camImpl;
   FListItem       *camItem;
-  GkTransform     *tr;
   GkLight         *light;
   GkInstanceMorph *morpher;
-  bool             finalComputed;
 
   sceneImpl = (GkSceneImpl *)scene;
   camItem   = sceneImpl->transfCacheSlots->first;
 
-  finalComputed = false;
-  if (!(tr = node->trans))
-    tr = node->trans = parentNode->trans;
-
-  if (!GK_FLG(tr->flags, GK_TRANSF_LOCAL_ISVALID))
-    gkTransformCombine(tr);
+  /* invalidate cached final transforms */
+  ((GkTransformImpl *)tr)->version++;
 
-  if (parentNode && (node->flags & GK_NODEF_HAVE_TRANSFORM))
-    glm_mul(parentNode->trans->world, tr->local, tr->world);
+  gkNodeSyncComps(scene, node);
 
   /* TODO: */
   /* gkTransformAABB(tr, node->bbox); */
 
+  /* geomInst->next links instances of same geometry in other nodes */
   if (node->geom) {
     GkGeometryInst *geomInst;
 
-    glm_vec3_scale(scene->center, sceneImpl->centercount, scene->center);
+    geomInst = node->geom;
+    if (!headReady)
+      gkPrepareGeomInst(geomInst, tr);
+
+    /* also refits scene bounds, center and layers in BVH */
+    geomInst->layers       = gkNodeLayers(node);
+    geomInst->addedToScene = true;
+    gkBVHUpdate(&sceneImpl->bvh, geomInst);
+    gkBoxSoAUpdate(&sceneImpl->cullBoxes, geomInst);
+
+    if ((morpher = node->morpher)
+        && geomInst->morpher != node->morpher) {
+      gkAttachMorphTo(morpher->morph, geomInst);
+      geomInst->morpher = node->morpher;
+    }
+  }
 
+  if ((light = node->light)) {
     while (camItem) {
       camImpl = camItem->data;
-      gkCalcFinalTransf(scene, &camImpl->pub, tr);
+      gkCalcViewTransf(scene, &camImpl->pub, tr);
       camItem = camItem->next;
     }
 
-    finalComputed = true;
-    geomInst     = node->geom;
-
-    do {
-      GkPrimInst *prims;
-      vec3        geomCenter;
-      int32_t     i, primc;
+    light->flags |= GK_LIGHTF_TRANSFORMED;
+    glm_vec3_rotate_m4(tr->world, light->defdir, light->dir);
+    glm_vec3_normalize(light->dir);
+  }
+}
 
-      geomInst->trans = tr;
-      glm_aabb_transform(geomInst->geom->bbox, tr->world, geomInst->bbox);
+static
+GK_INLINE
+void
+gkPrepareNodeContent(GkScene     * __restrict scene,
+                     GkNode      * __restrict node,
+                     GkTransform * __restrict tr) {
+  gkCommitNodeContent(scene, node, tr, false);
+}
 
-      prims = geomInst->prims;
-      primc = geomInst->primc;
+/* world matrix only, parent's world must be ready */
+static
+GK_INLINE
+GkTransform*
+gkPrepareNodeWorld(GkNode * __restrict parentNode,
+                   GkNode * __restrict node) {
+  GkTransform *tr;
 
-      glm_vec3_zero(geomCenter);
+  if (!(tr = node->trans))
+    tr = node->trans = parentNode->trans;
 
-      for (i = 0; i < primc; i++) {
-        glm_aabb_transform(prims[i].prim->bbox, tr->world, prims[i].bbox);
+  if (!GK_FLG(tr->flags, GK_TRANSF_LOCAL_ISVALID))
+    gkTransformCombine(tr);
 
-        gkUpdateSceneAABB(scene, prims[i].bbox);
-        prims[i].trans = tr;
-      }
+  if (parentNode && (node->flags & GK_NODEF_HAVE_TRANSFORM))
+    glm_mul(parentNode->trans->world, tr->local, tr->world);
 
-      glm_mat4_mulv3(tr->world,
-                     geomInst->geom->center,
-                     1.0f,
-                     geomInst->center);
+  return tr;
+}
 
-      if (geomInst->addedToScene) {
-        glm_vec3_sub(scene->center, geomInst->center, scene->center);
-      } else {
-        geomInst->addedToScene = true;
-        sceneImpl->centercount++;
-      }
+static
+void
+gkPrepareNode(GkScene * __restrict scene,
+              GkNode  * __restrict parentNode,
+              GkNode  * __restrict node) {
+  gkPrepareNodeContent(scene, node, gkPrepareNodeWorld(parentNode, node));
+}
 
-      glm_vec3_add(scene->center, geomInst->center, scene->center);
+GK_EXPORT
+void
+gkInvalidateNodeHierarchy(GkScene * __restrict scene) {
+  ((GkSceneImpl *)scene)->transStore.dirty = true;
+}
 
-      if ((morpher = node->morpher)
-          && geomInst->morpher != node->morpher) {
-        gkAttachMorphTo(morpher->morph, geomInst);
-        geomInst->morpher = node->morpher;
-      }
+/* world matrices and contents of subtree, skins are not updated */
+static
+void
+gkApplyTransformNoSkin(GkScene * __restrict scene,
+                       GkNode  * __restrict node) {
+  GkTransformStore *store;
+  GkTransform      *tr;
+  GkNode           *mostParent, *iter;
+  uint32_t          begin, end, i;
 
-      geomInst = geomInst->next;
-    } while (geomInst);
+  if (!(tr = node->trans))
+    node->trans = scene->trans;
 
-    glm_vec3_divs(scene->center, sceneImpl->centercount, scene->center);
-  }
+  /* subtree is a contiguous range in flat store */
+  if ((scene->flags & GK_SCENEF_FLAT_TRANSFORMS)
+      && gkTransformStoreRange(scene, node, &begin, &end)) {
+    gkTransformStoreUpdate(scene, begin, end);
 
-  if ((light = node->light)) {
-    if (!finalComputed) {
-      while (camItem) {
-        camImpl = camItem->data;
-        gkCalcViewTransf(scene, &camImpl->pub, tr);
-        camItem = camItem->next;
-      }
+    store = &((GkSceneImpl *)scene)->transStore;
+    for (i = begin; i < end; i++) {
+      iter = store->nodes[i];
+      if (iter->geom || iter->light)
+        gkPrepareNodeContent(scene, iter, iter->trans);
     }
 
-    light->flags |= GK_LIGHTF_TRANSFORMED;
-    glm_vec3_rotate_m4(tr->world, light->defdir, light->dir);
-    glm_vec3_normalize(light->dir);
+    return;
   }
-}
-
-GK_EXPORT
-void
-gkApplyTransform(GkScene * __restrict scene,
-                 GkNode  * __restrict node) {
-  GkTransform  *tr;
-  GkNode       *mostParent;
-
-  if (!(tr = node->trans))
-    node->trans = scene->trans;
 
   gkPrepareNode(scene, node->parent, node);
 
@@ -251,11 +473,244 @@ gkApplyTransform(GkScene * __restrict scene,
   }
 
 dn:; /* done */
+}
+
+GK_EXPORT
+void
+gkApplyTransform(GkScene * __restrict scene,
+                 GkNode  * __restrict node) {
+  gkApplyTransformNoSkin(scene, node);
+  gkUpdateSceneBounds(scene);
 
   /* TODO: optimize this */
   gkPrepInstSkin(scene);
 }
 
+GK_EXPORT
+void
+gkSetNodeLayers(GkScene * __restrict scene,
+                GkNode  * __restrict node,
+                uint32_t             layers) {
+  if (node->layers == layers)
+    return;
+
+  node->layers = layers;
+
+  /* instances of subtree are re-inserted with new layers */
+  gkMarkNodeDirty(scene, node);
+}
+
+GK_EXPORT
+uint32_t
+gkNodeLayers(GkNode * __restrict node) {
+  do {
+    if (node->layers)
+      return node->layers;
+  } while ((node = node->parent));
+
+  return GK_LAYER_DEFAULT;
+}
+
+GK_EXPORT
+void
+gkMarkNodeDirty(GkScene * __restrict scene,
+                GkNode  * __restrict node) {
+  GkSceneImpl *sceneImpl;
+
+  if (node->flags & GK_NODEF_TRANSF_DIRTY)
+    return;
+
+  sceneImpl    = (GkSceneImpl *)scene;
+  node->flags |= GK_NODEF_TRANSF_DIRTY;
+
+  if (sceneImpl->dirtyCount == sceneImpl->dirtySize) {
+    sceneImpl->dirtySize  = sceneImpl->dirtySize ? sceneImpl->dirtySize * 2 : 64;
+    sceneImpl->dirtyNodes = realloc(sceneImpl->dirtyNodes,
+                                    sceneImpl->dirtySize * sizeof(GkNode *));
+  }
+
+  sceneImpl->dirtyNodes[sceneImpl->dirtyCount++] = node;
+}
+
+/* next node of subtree in depth-first order, NULL at end */
+static
+GK_INLINE
+GkNode*
+gkSubtreeNext(GkNode * __restrict top, GkNode * __restrict node) {
+  if (node->chld)
+    return node->chld;
+
+  while (node != top) {
+    if (node->next)
+      return node->next;
+    node = node->parent;
+  }
+
+  return NULL;
+}
+
+/* world matrix and own geometry instance, no shared state is touched */
+static
+void
+gkPrepareNodeLocal(GkNode * __restrict node) {
+  GkTransform *tr;
+
+  tr = gkPrepareNodeWorld(node->parent, node);
+  if (node->geom)
+    gkPrepareGeomInst(node->geom, tr);
+}
+
+static
+void
+gkPrepareSubtreesJob(void *data, uint32_t begin, uint32_t end) {
+  GkNode  **tasks, *top, *node;
+  uint32_t  i;
+
+  tasks = data;
+  for (i = begin; i < end; i++) {
+    top = node = tasks[i];
+    do {
+      gkPrepareNodeLocal(node);
+    } while ((node = gkSubtreeNext(top, node)));
+  }
+}
+
+/*
+ subtrees of dirty roots are independent, world matrices and boxes are
+ computed by jobs then scene structures (BVH, culling boxes, center...) are
+ updated on this thread in same order as serial path.
+ */
+static
+void
+gkApplyTransformsParallel(GkScene * __restrict scene,
+                          GkNode ** __restrict roots,
+                          uint32_t             nroots,
+                          uint32_t             nworkers) {
+  GkNode     **tasks, *node, *chld;
+  GkTransform *tr;
+  uint32_t     i, ntasks, size, target;
+
+  size   = nroots * 4 + 64;
+  tasks  = malloc(size * sizeof(*tasks));
+  ntasks = 0;
+  target = nworkers * 4;
+
+  /* roots are done here, their children become jobs */
+  for (i = 0; i < nroots; i++) {
+    node = roots[i];
+    if (!(tr = node->trans))
+      tr = node->trans = scene->trans;
+
+    if (!node->parent) {
+      if (!GK_FLG(tr->flags, GK_TRANSF_LOCAL_ISVALID))
+        gkTransformCombine(tr);
+
+      if (node->chld)
+        glm_mul(scene->trans->world, tr->local, tr->world);
+
+      if (node->geom)
+        gkPrepareGeomInst(node->geom, tr);
+    } else {
+      gkPrepareNodeLocal(node);
+    }
+
+    for (chld = node->chld; chld; chld = chld->next) {
+      if (ntasks == size) {
+        size *= 2;
+        tasks = realloc(tasks, size * sizeof(*tasks));
+      }
+      tasks[ntasks++] = chld;
+    }
+  }
+
+  /* split big subtrees until there is enough work to steal */
+  for (i = 0; i < ntasks && ntasks < target; ) {
+    node = tasks[i];
+    if (!node->chld) {
+      i++;
+      continue;
+    }
+
+    gkPrepareNodeLocal(node);
+    tasks[i] = tasks[--ntasks];
+
+    for (chld = node->chld; chld; chld = chld->next) {
+      if (ntasks == size) {
+        size *= 2;
+        tasks = realloc(tasks, size * sizeof(*tasks));
+      }
+      tasks[ntasks++] = chld;
+    }
+  }
+
+  gkJobParallelFor(ntasks, 1, gkPrepareSubtreesJob, tasks);
+  free(tasks);
+
+  for (i = 0; i < nroots; i++) {
+    node = roots[i];
+    do {
+      gkCommitNodeContent(scene, node, node->trans, true);
+    } while ((node = gkSubtreeNext(roots[i], node)));
+  }
+}
+
+GK_EXPORT
+void
+gkFlushTransforms(GkScene * __restrict scene) {
+  GkSceneImpl *sceneImpl;
+  GkNode      *node, *parent, **roots;
+  uint32_t     i, count, nroots, nworkers;
+
+  sceneImpl = (GkSceneImpl *)scene;
+  if ((count = sceneImpl->dirtyCount) == 0) {
+    /* skins of shown layers may be stale */
+    if (sceneImpl->skinHiddenLayers != scene->hiddenLayers)
+      gkPrepInstSkin(scene);
+    return;
+  }
+
+  /* flat store already updates in one linear pass */
+  nworkers = 0;
+  if (!(scene->flags & GK_SCENEF_FLAT_TRANSFORMS))
+    nworkers = gkJobWorkerCount();
+
+  roots  = nworkers > 0 ? malloc(count * sizeof(*roots)) : NULL;
+  nroots = 0;
+
+  /* only dirty roots, subtrees of others are covered by them */
+  for (i = 0; i < count; i++) {
+    node = sceneImpl->dirtyNodes[i];
+    if (!(node->flags & GK_NODEF_NODE))
+      continue;
+
+    for (parent = node->parent; parent; parent = parent->parent) {
+      if (parent->flags & GK_NODEF_TRANSF_DIRTY)
+        break;
+    }
+
+    if (parent)
+      continue;
+
+    if (roots)
+      roots[nroots++] = node;
+    else
+      gkApplyTransformNoSkin(scene, node);
+  }
+
+  if (roots) {
+    gkApplyTransformsParallel(scene, roots, nroots, nworkers);
+    free(roots);
+  }
+
+  for (i = 0; i < count; i++)
+    sceneImpl->dirtyNodes[i]->flags &= ~GK_NODEF_TRANSF_DIRTY;
+
+  sceneImpl->dirtyCount = 0;
+
+  gkUpdateSceneBounds(scene);
+  gkPrepInstSkin(scene);
+}
+
 GK_INLINE
 void
 gkPrepareView(GkScene * __restrict scene,
@@ -265,86 +720,124 @@ gkPrepareView(GkScene * __restrict scene,
   FListItem    *camItem;
   GkTransform  *tr;
   GkLight      *light;
-  bool          finalComputed;
 
   sceneImpl = (GkSceneImpl *)scene;
   camItem   = sceneImpl->transfCacheSlots->first;
   tr        = node->trans;
+  light     = node->light;
 
-  if (!(tr->flags & GK_TRANSF_CALC_VIEW))
-    return;
-
-  finalComputed = false;
-  if (node->geom) {
-    while (camItem) {
-      camImpl = camItem->data;
-      gkCalcFinalTransf(scene, &camImpl->pub, tr);
-      camItem = camItem->next;
-    }
-
-    finalComputed = true;
+  while (camItem) {
+    camImpl = camItem->data;
+    gkCalcViewTransf(scene, &camImpl->pub, tr);
+    camItem = camItem->next;
   }
 
-  if ((light = node->light)) {
-    if (!finalComputed) {
-      while (camItem) {
-        camImpl = camItem->data;
-        gkCalcViewTransf(scene, &camImpl->pub, tr);
-        camItem = camItem->next;
-      }
-    }
-
-    light->flags |= GK_LIGHTF_TRANSFORMED;
-    glm_vec3_rotate_m4(tr->world, light->defdir, light->dir);
-    glm_vec3_normalize(light->dir);
-  }
+  light->flags |= GK_LIGHTF_TRANSFORMED;
+  glm_vec3_rotate_m4(tr->world, light->defdir, light->dir);
+  glm_vec3_normalize(light->dir);
 }
 
 GK_EXPORT
 void
 gkApplyView(struct GkScene * __restrict scene,
             GkNode         * __restrict node) {
-  GkNodePage     *np;
   GkSceneImpl    *sceneImpl;
-  GkGeometryInst *geomInst;
-  size_t          i;
+  GkNodeCompList *lights;
+  GkNode         *lightNode;
+  uint32_t        i, hidden;
 
   sceneImpl = (GkSceneImpl *)scene;
-  np        = sceneImpl->lastPage;
-
-  /* invalidate */
-  while (np) {
-    for (i = 0; i < gk_nodesPerPage; i++) {
-      node = &np->nodes[i];
+  hidden    = scene->hiddenLayers;
 
-      /* unallocated node */
-      if (!(node->flags & GK_NODEF_NODE)
-          || !(geomInst = node->geom))
-        continue;
+  sceneImpl->viewHiddenLayers = hidden;
 
-      while (geomInst) {
-        geomInst->trans->flags |= GK_TRANSF_CALC_VIEW;
-        geomInst = geomInst->next;
-      }
-    }
+  /* geometries' final transforms become stale, they will be computed
+     again after culling only if they are visible */
+  ((GkCameraImpl *)scene->camera)->viewVersion++;
 
-    np = np->next;
+  /* only lights need view space transform before rendering */
+  lights = &sceneImpl->comps[GK_NODE_COMP_LIGHT];
+  for (i = 0; i < lights->count; i++) {
+    lightNode = lights->items[i].node;
+    if (gkNodeLayers(lightNode) & ~hidden)
+      gkPrepareView(scene, lightNode);
   }
+}
 
-  np = sceneImpl->lastPage;
-  while (np) {
-    for (i = 0; i < gk_nodesPerPage; i++) {
-      node = &np->nodes[i];
+/* controller instances which share a skin source are one work item */
+typedef struct GkSkinWork {
+  GkControllerInst *ctlrInst;
+  GkGeometryInst   *geomInst;
+  uint32_t          order;
+} GkSkinWork;
 
-      /* unallocated node */
-      if (!(node->flags & GK_NODEF_NODE))
-        continue;
+typedef struct GkSkinJob {
+  GkScene    *scene;
+  GkSkinWork *items;
+  uint32_t   *groups; /* first item of each source, plus end */
+} GkSkinJob;
 
-      if (node->geom || node->light)
-        gkPrepareView(scene, node);
+static
+int
+gkSkinWorkCmp(const void *a, const void *b) {
+  const GkSkinWork *wa, *wb;
+
+  wa = a;
+  wb = b;
+
+  if (wa->geomInst != wb->geomInst)
+    return (uintptr_t)wa->geomInst < (uintptr_t)wb->geomInst ? -1 : 1;
+
+  return wa->order < wb->order ? -1 : (wa->order > wb->order);
+}
+
+static
+void
+gkPrepSkinJoints(GkScene          * __restrict scene,
+                 GkGeometryInst   * __restrict geomInst,
+                 GkControllerInst * __restrict ctlrInst) {
+  GkSkin  *skin;
+  GkNode **joints;
+  GkNode  *joint;
+  size_t   nJoints, i;
+  bool     bones;
+
+  skin    = (GkSkin *)ctlrInst->ctlr;
+  nJoints = skin->nJoints;
+  bones   = scene->flags & GK_SCENEF_DRAW_BONES;
+
+  if (!(joints = ctlrInst->joints) && !(joints = skin->joints))
+    return;
+
+  for (i = 0; i < nJoints; i++) {
+    if ((joint = joints[i])) {
+      glm_mat4_mulN((mat4 *[]){
+        (mat4 *)joint->trans->world,
+        &skin->invBindPoses[i],
+        &skin->bindShapeMatrix
+      }, 3, geomInst->joints[i]);
+
+      if (bones)
+        glm_mat4_copy(joint->trans->world, geomInst->jointsToDraw[i]);
     }
+  }
+}
 
-    np = np->next;
+/* joint matrices of skin sources in [begin, end), no GL calls here.
+   a source is written by one task, its controllers in scene order */
+static
+void
+gkPrepInstSkinJob(void *data, uint32_t begin, uint32_t end) {
+  GkSkinJob  *job;
+  GkSkinWork *item;
+  uint32_t    g, k;
+
+  job = data;
+  for (g = begin; g < end; g++) {
+    for (k = job->groups[g]; k < job->groups[g + 1]; k++) {
+      item = &job->items[k];
+      gkPrepSkinJoints(job->scene, item->geomInst, item->ctlrInst);
+    }
   }
 }
 
@@ -353,70 +846,72 @@ static
 void
 gkPrepInstSkin(GkScene * __restrict scene) {
   GkSceneImpl      *sceneImpl;
-  FListItem        *item;
-  GkNode           *node;
+  GkNodeCompList   *skinned;
   GkControllerInst *ctlrInst;
   GkGeometryInst   *geomInst;
-
-  GkSkin *skin;
-  GkNode *joint;
-  size_t  nJoints, i;
+  GkSkin           *skin;
+  GkSkinWork       *items;
+  GkSkinJob         job;
+  uint32_t          j, n, ngroups, hidden;
 
   sceneImpl = (GkSceneImpl *)scene;
-  if ((item = sceneImpl->instSkins)) {
-    do {
-      node     = item->data;
-      ctlrInst = node->controller;
-
-      if (ctlrInst->ctlr && ctlrInst->ctlr->type == GK_CONTROLLER_SKIN) {
-        skin      = (GkSkin *)ctlrInst->ctlr;
-        nJoints   = skin->nJoints;
-        geomInst = skin->base.source;
-
-        if (!geomInst->joints) {
-          geomInst->joints = malloc(sizeof(mat4) * skin->nJoints);
-          glm_mat4_identity_array(geomInst->joints, skin->nJoints);
-        }
-
-        if (ctlrInst->joints) {
-          for (i = 0; i < nJoints; i++) {
-            if ((joint = ctlrInst->joints[i])) {
-              glm_mat4_mulN((mat4 *[]){
-                &joint->trans->world,
-                &skin->invBindPoses[i],
-                &skin->bindShapeMatrix
-              }, 3, geomInst->joints[i]);
-
-              if (scene->flags & GK_SCENEF_DRAW_BONES) {
-                if (!geomInst->jointsToDraw)
-                  geomInst->jointsToDraw = malloc(sizeof(mat4) * skin->nJoints);
-
-                glm_mat4_copy(joint->trans->world, geomInst->jointsToDraw[i]);
-              }
-            }
-          }
-        } else if (skin->joints) {
-          for (i = 0; i < nJoints; i++) {
-            if ((joint = skin->joints[i])) {
-              glm_mat4_mulN((mat4 *[]){
-                &joint->trans->world,
-                &skin->invBindPoses[i],
-                &skin->bindShapeMatrix
-              }, 3, geomInst->joints[i]);
-
-              if (scene->flags & GK_SCENEF_DRAW_BONES) {
-                if (!geomInst->jointsToDraw)
-                  geomInst->jointsToDraw = malloc(sizeof(mat4) * skin->nJoints);
-
-                glm_mat4_copy(joint->trans->world, geomInst->jointsToDraw[i]);
-              }
-            }
-          }
-        }
-
-        /* TODO: optimize this */
-        gkUniformJoints(scene, geomInst);
-      }
-    } while ((item = item->next));
+  skinned   = &sceneImpl->comps[GK_NODE_COMP_SKINNED];
+  hidden    = scene->hiddenLayers;
+
+  sceneImpl->skinHiddenLayers = hidden;
+
+  if (skinned->count == 0)
+    return;
+
+  items = malloc(sizeof(*items) * skinned->count);
+  n     = 0;
+
+  /* buffers are allocated here, tasks only write to them */
+  for (j = 0; j < skinned->count; j++) {
+    ctlrInst = skinned->items[j].item;
+    if (!ctlrInst->ctlr || ctlrInst->ctlr->type != GK_CONTROLLER_SKIN)
+      continue;
+
+    skin     = (GkSkin *)ctlrInst->ctlr;
+    geomInst = skin->base.source;
+
+    /* hidden skins are updated when their layers are shown again */
+    if (!(geomInst->layers & ~hidden))
+      continue;
+
+    if (!geomInst->joints) {
+      geomInst->joints = malloc(sizeof(mat4) * skin->nJoints);
+      glm_mat4_identity_array(geomInst->joints, skin->nJoints);
+    }
+
+    if ((scene->flags & GK_SCENEF_DRAW_BONES) && !geomInst->jointsToDraw)
+      geomInst->jointsToDraw = malloc(sizeof(mat4) * skin->nJoints);
+
+    items[n].ctlrInst = ctlrInst;
+    items[n].geomInst = geomInst;
+    items[n].order    = j;
+    n++;
   }
+
+  qsort(items, n, sizeof(*items), gkSkinWorkCmp);
+
+  job.scene  = scene;
+  job.items  = items;
+  job.groups = malloc(sizeof(uint32_t) * (n + 1));
+  ngroups    = 0;
+
+  for (j = 0; j < n; j++) {
+    if (j == 0 || items[j].geomInst != items[j - 1].geomInst)
+      job.groups[ngroups++] = j;
+  }
+  job.groups[ngroups] = n;
+
+  gkJobParallelFor(ngroups, 8, gkPrepInstSkinJob, &job);
+
+  /* uploads stay on GL thread */
+  for (j = 0; j < ngroups; j++)
+    gkUniformJoints(scene, items[job.groups[j]].geomInst);
+
+  free(job.groups);
+  free(items);
 }
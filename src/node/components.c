@@ -0,0 +1,105 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../common.h"
+#include "../types/impl_scene.h"
+#include "components.h"
+
+void
+gkNodeCompAdd(GkScene        * __restrict scene,
+              GkNode         * __restrict node,
+              GkNodeCompType              type,
+              void           * __restrict item) {
+  GkNodeCompList *list;
+  GkNodeImpl     *nodeImpl;
+  uint32_t        idx;
+
+  list     = &((GkSceneImpl *)scene)->comps[type];
+  nodeImpl = (GkNodeImpl *)node;
+
+  if ((idx = nodeImpl->comp[type]) != 0) {
+    list->items[idx - 1].item = item;
+    return;
+  }
+
+  if (list->count == list->size) {
+    list->size  = list->size ? list->size * 2 : 32;
+    list->items = realloc(list->items, list->size * sizeof(*list->items));
+  }
+
+  list->items[list->count].node = node;
+  list->items[list->count].item = item;
+
+  nodeImpl->comp[type] = ++list->count;
+}
+
+void
+gkNodeCompRemove(GkScene        * __restrict scene,
+                 GkNode         * __restrict node,
+                 GkNodeCompType              type) {
+  GkNodeCompList *list;
+  GkNodeImpl     *nodeImpl, *lastImpl;
+  uint32_t        idx;
+
+  list     = &((GkSceneImpl *)scene)->comps[type];
+  nodeImpl = (GkNodeImpl *)node;
+
+  if ((idx = nodeImpl->comp[type]) == 0)
+    return;
+
+  /* swap with last */
+  list->items[idx - 1] = list->items[--list->count];
+  if (idx - 1 < list->count) {
+    lastImpl             = (GkNodeImpl *)list->items[idx - 1].node;
+    lastImpl->comp[type] = idx;
+  }
+
+  nodeImpl->comp[type] = 0;
+}
+
+static
+GK_INLINE
+void
+gkNodeSyncComp(GkScene        * __restrict scene,
+               GkNode         * __restrict node,
+               GkNodeCompType              type,
+               void           * __restrict item) {
+  if (item)
+    gkNodeCompAdd(scene, node, type, item);
+  else
+    gkNodeCompRemove(scene, node, type);
+}
+
+void
+gkNodeSyncComps(GkScene * __restrict scene,
+                GkNode  * __restrict node) {
+  gkNodeSyncComp(scene, node, GK_NODE_COMP_RENDERABLE, node->geom);
+  gkNodeSyncComp(scene, node, GK_NODE_COMP_LIGHT,      node->light);
+  gkNodeSyncComp(scene, node, GK_NODE_COMP_CAMERA,     node->camera);
+  gkNodeSyncComp(scene, node, GK_NODE_COMP_SKINNED,    node->controller);
+  gkNodeSyncComp(scene, node, GK_NODE_COMP_MORPHED,    node->morpher);
+}
+
+void
+gkNodeRemoveComps(GkScene * __restrict scene,
+                  GkNode  * __restrict node) {
+  uint32_t i;
+
+  for (i = 0; i < GK_NODE_COMP_COUNT; i++)
+    gkNodeCompRemove(scene, node, (GkNodeCompType)i);
+}
@@ -0,0 +1,71 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef node_components_h
+#define node_components_h
+
+#include "../../include/gk/gk.h"
+#include "../../include/gk/node.h"
+
+/*
+ dense per-kind arrays of nodes, systems which only need lights, skinned
+ nodes etc. iterate their own array instead of all nodes. GkNode fields stay
+ as public view, arrays are synced from them.
+ */
+typedef enum GkNodeCompType {
+  GK_NODE_COMP_RENDERABLE = 0, /* item: GkGeometryInst   */
+  GK_NODE_COMP_LIGHT      = 1, /* item: GkLight          */
+  GK_NODE_COMP_CAMERA     = 2, /* item: GkCamera         */
+  GK_NODE_COMP_SKINNED    = 3, /* item: GkControllerInst */
+  GK_NODE_COMP_MORPHED    = 4, /* item: GkInstanceMorph  */
+  GK_NODE_COMP_COUNT      = 5
+} GkNodeCompType;
+
+typedef struct GkNodeComp {
+  GkNode *node;
+  void   *item;
+} GkNodeComp;
+
+typedef struct GkNodeCompList {
+  GkNodeComp *items;
+  uint32_t    count;
+  uint32_t    size;
+} GkNodeCompList;
+
+/* adds node to list or updates its item if it is already there */
+void
+gkNodeCompAdd(GkScene        * __restrict scene,
+              GkNode         * __restrict node,
+              GkNodeCompType              type,
+              void           * __restrict item);
+
+void
+gkNodeCompRemove(GkScene        * __restrict scene,
+                 GkNode         * __restrict node,
+                 GkNodeCompType              type);
+
+/* adds or removes renderable, light, camera... by node's fields */
+void
+gkNodeSyncComps(GkScene * __restrict scene,
+                GkNode  * __restrict node);
+
+void
+gkNodeRemoveComps(GkScene * __restrict scene,
+                  GkNode  * __restrict node);
+
+#endif /* node_components_h */
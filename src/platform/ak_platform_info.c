@@ -20,10 +20,18 @@
 #include "../../include/gk/gk.h"
 #include "../../include/gk/platform.h"
 
+#include <string.h>
+
 /* Default expected values */
 GLint GK_PLI[] =
 {
-  16                               /* 0:  _MAX_TEX_UNIT                */
+  16,                              /* 0:  _MAX_TEX_UNIT                */
+  0,                               /* 1:  _PARALLEL_COMPILE            */
+  0,                               /* 2:  _CONSERVATIVE_QUERY          */
+  0,                               /* 3:  _MULTI_DRAW                  */
+  0,                               /* 4:  _COMPUTE                     */
+  0,                               /* 5:  _BUFFER_STORAGE              */
+  256                              /* 6:  _UBO_ALIGNMENT               */
 };
 
 void  *gk_glcontext    = NULL;
@@ -47,12 +55,51 @@ gkPlatfomInfo(GkPlatformInfo pli) {
   return GK_PLI[pli];
 }
 
+static
+bool
+gk__hasExtension(const char * __restrict name) {
+  GLint i, count;
+
+  count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+  for (i = 0; i < count; i++) {
+    if (strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), name) == 0)
+      return true;
+  }
+
+  return false;
+}
+
 void
 gk_pl_fetchPLI() {
+  GLint major, minor;
+
   if (!gk_glcontext)
     return;
 
   glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &gk_glcontextPLI[0]);
+
+  gk_glcontextPLI[1] = gk__hasExtension("GL_KHR_parallel_shader_compile")
+                        || gk__hasExtension("GL_ARB_parallel_shader_compile");
+
+  major = minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+  gk_glcontextPLI[2] = major > 4 || (major == 4 && minor >= 3)
+                        || gk__hasExtension("GL_ARB_ES3_compatibility");
+
+  /* base instance is 4.2, it selects per draw data */
+  gk_glcontextPLI[3] = major > 4 || (major == 4 && minor >= 3)
+                        || (gk__hasExtension("GL_ARB_multi_draw_indirect")
+                            && gk__hasExtension("GL_ARB_base_instance"));
+
+  gk_glcontextPLI[4] = major > 4 || (major == 4 && minor >= 3);
+  gk_glcontextPLI[5] = major > 4 || (major == 4 && minor >= 4)
+                        || gk__hasExtension("GL_ARB_buffer_storage");
+
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &gk_glcontextPLI[6]);
 }
 
 void
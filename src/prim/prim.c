@@ -93,4 +93,7 @@ gk_attachInputTo(GkPrimInst         * __restrict primInst,
   }
  
   gk_va_bindInputTo(va, inp, startLoc);
+
+  /* inputs changed, cached pipeline is not valid anymore */
+  primInst->vertexVersion++;
 }
@@ -36,7 +36,15 @@ GLushort gk__verts_cube_ind[] = {
    0, 1, 2, 3,
    4, 5, 6, 7,
    0, 4, 1, 5,
-   2, 6, 3, 7
+   2, 6, 3, 7,
+
+   /* faces */
+   0, 2, 1,  0, 3, 2,
+   4, 5, 6,  4, 6, 7,
+   0, 1, 5,  0, 5, 4,
+   3, 6, 2,  3, 7, 6,
+   0, 4, 7,  0, 7, 3,
+   1, 2, 6,  1, 6, 5
 };
 
 GLuint gk__cube_vao = UINT_MAX;
@@ -116,6 +124,33 @@ gkDrawBBox(GkScene * __restrict scene,
   glUseProgram(currentProg);
 }
 
+void
+gkDrawBBoxFaces(GkScene    * __restrict scene,
+                GkPipeline * __restrict prog,
+                GkBBox                  bbox) {
+  vec3 size, center;
+  mat4 tran = GLM_MAT4_IDENTITY_INIT;
+
+  if (gk__cube_vao == UINT_MAX)
+    gkInitCube();
+  else
+    glBindVertexArray(gk__cube_vao);
+
+  glm_vec3_sub(bbox[1], bbox[0], size);
+  glm_vec3_center(bbox[1], bbox[0], center);
+
+  glm_translate(tran, center);
+  glm_scale(tran, size);
+  glm_mat4_mul(scene->camera->viewProj, tran, tran);
+
+  gkUniformMat4(prog->mvpi, tran);
+
+  glDrawElements(GL_TRIANGLES,
+                 36,
+                 GL_UNSIGNED_SHORT,
+                 (GLvoid *)(16 * sizeof(GLushort)));
+}
+
 void
 gkReleaseCube() {
   if (gk__cube_vao == UINT_MAX)
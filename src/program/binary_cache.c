@@ -0,0 +1,260 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../common.h"
+#include "../../include/gk/opt.h"
+#include "binary_cache.h"
+#include "program.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <tm/tm.h>
+
+/*
+ Program binaries are stored per variant key as:
+   [dir]/[key]-[driver].bin
+ key must be same for same shaders in every run, material variants pass
+ their key with layout id replaced by hash of layout (see gk__diskKey).
+ driver is hash of GL_VENDOR, GL_RENDERER and GL_VERSION so that binaries
+ will not be used after driver updates or on another GPU, header is also
+ checked before using binary.
+ */
+
+#define GK_PROGBIN_MAGIC   0x42504b47u /* GKPB */
+#define GK_PROGBIN_VERSION 2u
+
+typedef struct GkProgramBinaryHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t driver;
+  uint64_t key;
+  uint32_t format;
+  uint32_t length;
+} GkProgramBinaryHeader;
+
+static GkProgramCacheStats gk__progCacheStats;
+static uint64_t            gk__driverHash;
+static int                 gk__binarySupport = -1;
+
+static
+_gk_hide
+uint64_t
+gk__fnv1a(uint64_t hash, const char * __restrict str) {
+  if (!str)
+    return hash;
+
+  while (*str) {
+    hash ^= (unsigned char)*str++;
+    hash *= 0x100000001b3ull;
+  }
+
+  return hash;
+}
+
+static
+_gk_hide
+uint64_t
+gk__driver(void) {
+  uint64_t hash;
+
+  if (gk__driverHash)
+    return gk__driverHash;
+
+  hash = 0xcbf29ce484222325ull;
+  hash = gk__fnv1a(hash, (const char *)glGetString(GL_VENDOR));
+  hash = gk__fnv1a(hash, (const char *)glGetString(GL_RENDERER));
+  hash = gk__fnv1a(hash, (const char *)glGetString(GL_VERSION));
+
+  return (gk__driverHash = hash ? hash : 1);
+}
+
+static
+_gk_hide
+char*
+gk__binaryPath(uint64_t key) {
+  const char *dir;
+  char       *path;
+  size_t      len;
+
+  dir  = (const char *)gk_opt(GK_OPT_PROG_CACHE_DIR);
+  len  = strlen(dir) + 40;
+  path = malloc(len);
+
+  snprintf(path,
+           len,
+           "%s/%016llx-%016llx.bin",
+           dir,
+           (unsigned long long)key,
+           (unsigned long long)gk__driver());
+
+  return path;
+}
+
+bool
+gkProgramCacheEnabled(void) {
+  GLint nFormats;
+
+  if (!gk_opt(GK_OPT_PROG_CACHE_DIR))
+    return false;
+
+  if (gk__binarySupport < 0) {
+    nFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nFormats);
+    gk__binarySupport = nFormats > 0;
+  }
+
+  return gk__binarySupport;
+}
+
+GkPipeline*
+gkProgramCacheLoad(uint64_t key) {
+  GkProgramBinaryHeader hdr;
+  GkPipeline           *prog;
+  FILE                 *file;
+  char                 *path;
+  void                 *blob;
+  double                start;
+  GLuint                progId;
+
+  if (!gkProgramCacheEnabled())
+    return NULL;
+
+  start = tm_time();
+  path  = gk__binaryPath(key);
+  blob  = NULL;
+  prog  = NULL;
+
+  if (!(file = fopen(path, "rb")))
+    goto miss;
+
+  if (fread(&hdr, sizeof(hdr), 1, file) != 1
+      || hdr.magic   != GK_PROGBIN_MAGIC
+      || hdr.version != GK_PROGBIN_VERSION
+      || hdr.driver  != gk__driver()
+      || hdr.key     != key
+      || hdr.length  == 0
+      || !(blob = malloc(hdr.length))
+      || fread(blob, hdr.length, 1, file) != 1) {
+    fclose(file);
+    goto reject;
+  }
+
+  fclose(file);
+
+  progId = glCreateProgram();
+  glProgramBinary(progId, hdr.format, blob, hdr.length);
+
+  /* driver may reject binary any time e.g. after update */
+  if (!gkProgramIsValid(progId)) {
+    glDeleteProgram(progId);
+    goto reject;
+  }
+
+  prog         = calloc(1, sizeof(*prog));
+  prog->progId = progId;
+  gkSetupPipeline(prog);
+
+  free(blob);
+  free(path);
+
+  gk__progCacheStats.hits++;
+  gk__progCacheStats.loadTime += tm_time() - start;
+
+  return prog;
+
+reject:
+  gk__progCacheStats.rejected++;
+  remove(path);
+
+miss:
+  free(blob);
+  free(path);
+
+  gk__progCacheStats.misses++;
+
+  return NULL;
+}
+
+void
+gkProgramCacheStore(uint64_t                 key,
+                    GkPipeline * __restrict prog,
+                    double                   compileTime) {
+  GkProgramBinaryHeader hdr;
+  FILE                 *file;
+  char                 *path, *tmpPath;
+  void                 *blob;
+  size_t                len;
+  GLint                 length;
+  GLenum                format;
+  bool                  ok;
+
+  gk__progCacheStats.compileTime += compileTime;
+
+  if (!gkProgramCacheEnabled() || !gkProgramIsValid(prog->progId))
+    return;
+
+  length = 0;
+  glGetProgramiv(prog->progId, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return;
+
+  blob   = malloc(length);
+  format = 0;
+  glGetProgramBinary(prog->progId, length, &length, &format, blob);
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic   = GK_PROGBIN_MAGIC;
+  hdr.version = GK_PROGBIN_VERSION;
+  hdr.driver  = gk__driver();
+  hdr.key     = key;
+  hdr.format  = format;
+  hdr.length  = (uint32_t)length;
+
+  path    = gk__binaryPath(key);
+  len     = strlen(path) + 5;
+  tmpPath = malloc(len);
+  snprintf(tmpPath, len, "%s.tmp", path);
+
+  /* write to temp file then rename, so readers never see partial files */
+  if ((file = fopen(tmpPath, "wb"))) {
+    ok = fwrite(&hdr, sizeof(hdr), 1, file) == 1
+         && fwrite(blob, length, 1, file) == 1;
+    ok = fclose(file) == 0 && ok;
+
+    if (ok && rename(tmpPath, path) == 0)
+      gk__progCacheStats.stores++;
+    else
+      remove(tmpPath);
+  }
+
+  free(tmpPath);
+  free(path);
+  free(blob);
+}
+
+GK_EXPORT
+void
+gkProgramCacheStats(GkProgramCacheStats * __restrict stats) {
+  *stats = gk__progCacheStats;
+}
+
+GK_EXPORT
+void
+gkResetProgramCacheStats(void) {
+  memset(&gk__progCacheStats, 0, sizeof(gk__progCacheStats));
+}
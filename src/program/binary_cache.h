@@ -0,0 +1,38 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef src_binary_cache_h
+#define src_binary_cache_h
+
+#include "../../include/gk/gk.h"
+#include "../../include/gk/program.h"
+
+bool
+gkProgramCacheEnabled(void);
+
+/* returns NULL if there is no usable binary for key */
+GkPipeline*
+gkProgramCacheLoad(uint64_t key);
+
+/* compileTime: seconds spent to compile and link prog, for stats */
+void
+gkProgramCacheStore(uint64_t                 key,
+                    GkPipeline * __restrict prog,
+                    double                   compileTime);
+
+#endif /* src_binary_cache_h */
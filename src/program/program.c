@@ -21,14 +21,83 @@
 #include "../../include/gk/shader.h"
 #include "../default/shader/def_shader.h"
 
+#include "../../include/gk/platform.h"
 #include "program.h"
+#include "binary_cache.h"
 #include "../state/gpu.h"
+#include "../render/realtime/draw_ring.h"
 #include <stdlib.h>
 #include <string.h>
+#include <tm/tm.h>
 
 #include <ds/rb.h>
 
-static RBTree *gk_progs;
+#ifndef GL_COMPLETION_STATUS_KHR
+#  define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef struct GkPipelineSlot {
+  uint64_t    key;
+  GkPipeline *prog;
+} GkPipelineSlot;
+
+static RBTree         *gk_progs;
+
+/* open addressing (linear probing) map for pipelines which have 64bit keys */
+static GkPipelineSlot *gk__keyedProgs;
+static uint32_t        gk__keyedProgsSize;
+static uint32_t        gk__keyedProgsCount;
+
+static
+_gk_hide
+uint32_t
+gk__progKeyHash(uint64_t key) {
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdull;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ull;
+  key ^= key >> 33;
+
+  return (uint32_t)key;
+}
+
+static
+_gk_hide
+GkPipelineSlot*
+gk__progSlot(GkPipelineSlot *slots, uint32_t size, uint64_t key) {
+  uint32_t mask, i;
+
+  mask = size - 1;
+  i    = gk__progKeyHash(key) & mask;
+
+  while (slots[i].key && slots[i].key != key)
+    i = (i + 1) & mask;
+
+  return &slots[i];
+}
+
+static
+_gk_hide
+void
+gk__progsGrow(void) {
+  GkPipelineSlot *slots, *old;
+  uint32_t        size, oldSize, i;
+
+  old     = gk__keyedProgs;
+  oldSize = gk__keyedProgsSize;
+  size    = oldSize * 2;
+  slots   = calloc(size, sizeof(*slots));
+
+  for (i = 0; i < oldSize; i++) {
+    if (old[i].key)
+      *gk__progSlot(slots, size, old[i].key) = old[i];
+  }
+
+  gk__keyedProgs     = slots;
+  gk__keyedProgsSize = size;
+
+  free(old);
+}
 
 void
 gkProgramLogInfo(GLuint progId,
@@ -41,10 +110,10 @@ gkProgramLogInfo(GLuint progId,
                  &infoLogLen);
   infoLog = malloc(sizeof(*infoLog) * infoLogLen + 1);
 
-  glGetShaderInfoLog(progId,
-                     infoLogLen,
-                     NULL,
-                     infoLog);
+  glGetProgramInfoLog(progId,
+                      infoLogLen,
+                      NULL,
+                      infoLog);
 
   fprintf(file,
           " -- Info Log For Program: %d -- \n",
@@ -118,9 +187,112 @@ gkNewPipeline(GkShader *shaders,
   }
 #endif
 
-  glUseProgram(progId);
+  prog->shaders = shaders;
+  gkSetupPipeline(prog);
+
+  return prog;
+}
 
+GkPipeline*
+gkNewPipelineAsync(GkShader *shaders,
+                   void    (*beforeLink)(GkPipeline *prog, void *data),
+                   void     *userData,
+                   uint64_t  key) {
+  GkPipeline      *prog;
+  GkPipelineBuild *build;
+  GLuint           progId;
+
+  prog         = calloc(1, sizeof(*prog));
+  build        = calloc(1, sizeof(*build));
+  build->key   = key;
+  build->start = tm_time();
+
+  prog->progId  = progId = glCreateProgram();
   prog->shaders = shaders;
+  prog->build   = build;
+
+  gkAttachShaders(progId, shaders);
+
+  if (beforeLink)
+    beforeLink(prog, userData);
+
+  /* don't query anything until it is completed, it would block */
+  glLinkProgram(progId);
+
+  return prog;
+}
+
+static
+_gk_hide
+bool
+gk__finishPipeline(GkPipeline * __restrict prog) {
+  GkPipelineBuild *build;
+  GkShader        *shader;
+
+  build = prog->build;
+
+  if (!gkProgramIsValid(prog->progId)) {
+    for (shader = prog->shaders; shader; shader = shader->next)
+      gkShaderLogInfo(shader->shaderId, stderr);
+
+    gkProgramLogInfo(prog->progId, stderr);
+
+    build->failed = true;
+    return false;
+  }
+
+  gkSetupPipeline(prog);
+
+  if (build->key)
+    gkProgramCacheStore(build->key, prog, tm_time() - build->start);
+
+  prog->build = NULL;
+  free(build);
+
+  return true;
+}
+
+bool
+gkPipelineIsReady(GkPipeline * __restrict prog) {
+  GkPipelineBuild *build;
+  GLint            completed;
+
+  if (!(build = prog->build))
+    return true;
+
+  if (build->failed)
+    return false;
+
+  /* without parallel compile ext. this finishes it at first use, but still
+     other variants which are issued together could be compiled in parallel */
+  if (gkPlatfomInfo(GK_PLI_PARALLEL_COMPILE)) {
+    completed = GL_FALSE;
+    glGetProgramiv(prog->progId, GL_COMPLETION_STATUS_KHR, &completed);
+    if (!completed)
+      return false;
+  }
+
+  return gk__finishPipeline(prog);
+}
+
+bool
+gkPipelineWait(GkPipeline * __restrict prog) {
+  GkPipelineBuild *build;
+
+  if (!(build = prog->build))
+    return true;
+
+  if (build->failed)
+    return false;
+
+  return gk__finishPipeline(prog);
+}
+
+void
+gkSetupPipeline(GkPipeline * __restrict prog) {
+  GLuint progId, idx;
+
+  progId = prog->progId;
 
   prog->mvpi = glGetUniformLocation(progId, "MVP");
   prog->mvi  = glGetUniformLocation(progId, "MV");
@@ -138,8 +310,16 @@ gkNewPipeline(GkShader *shaders,
   glUniformBlockBinding(prog->progId,
                         glGetUniformBlockIndex(prog->progId, "TargetBlock"),
                         2);
-  
-  return prog;
+
+  /* generated shaders with TRANSFORM_UBO, see draw_ring.h */
+  if ((idx = glGetUniformBlockIndex(progId, "CameraBlock")) != GL_INVALID_INDEX)
+    glUniformBlockBinding(progId, idx, GK_UBO_CAMERA);
+
+  idx             = glGetUniformBlockIndex(progId, "DrawBlock");
+  prog->drawBlock = idx != GL_INVALID_INDEX;
+
+  if (prog->drawBlock)
+    glUniformBlockBinding(progId, idx, GK_UBO_DRAW);
 }
 
 GkPipeline*
@@ -208,6 +388,34 @@ gkGetPipeline(char       *name,
   return NULL;
 }
 
+GkPipeline*
+gkGetPipelineByKey(uint64_t    key,
+                   GkPipeline *(creatCb)(uint64_t key, void *userData),
+                   void       *userData) {
+  GkPipelineSlot *slot;
+  GkPipeline     *prog;
+
+  /* 0 is reserved for empty slots */
+  slot = gk__progSlot(gk__keyedProgs, gk__keyedProgsSize, key);
+  if (slot->key)
+    return slot->prog;
+
+  if (!creatCb || !(prog = creatCb(key, userData)))
+    return NULL;
+
+  /* keep load factor under 0.75 */
+  if ((gk__keyedProgsCount + 1) * 4 > gk__keyedProgsSize * 3) {
+    gk__progsGrow();
+    slot = gk__progSlot(gk__keyedProgs, gk__keyedProgsSize, key);
+  }
+
+  slot->key  = key;
+  slot->prog = prog;
+  gk__keyedProgsCount++;
+
+  return prog;
+}
+
 GK_EXPORT
 void
 gkUseProgram(GkContext *ctx,
@@ -221,10 +429,18 @@ gkUseProgram(GkContext *ctx,
 
 void
 gk_prog_init() {
-  gk_progs = rb_newtree_str();
+  gk_progs            = rb_newtree_str();
+  gk__keyedProgsSize  = 64;
+  gk__keyedProgsCount = 0;
+  gk__keyedProgs      = calloc(gk__keyedProgsSize, sizeof(*gk__keyedProgs));
 }
 
 void
 gk_prog_deinit() {
   rb_destroy(gk_progs);
+  free(gk__keyedProgs);
+
+  gk__keyedProgs      = NULL;
+  gk__keyedProgsSize  = 0;
+  gk__keyedProgsCount = 0;
 }
@@ -19,10 +19,25 @@
 #ifndef src_program_h
 #define src_program_h
 
+#include <stdint.h>
+#include <stdbool.h>
+
+struct GkPipeline;
+
+typedef struct GkPipelineBuild {
+  uint64_t key;   /* variant key for binary cache, 0 if there is no key */
+  double   start;
+  bool     failed;
+} GkPipelineBuild;
+
 void
 gk_prog_init(void);
 
 void
 gk_prog_deinit(void);
 
+/* uniform locations, block bindings... after program is linked */
+void
+gkSetupPipeline(struct GkPipeline * __restrict prog);
+
 #endif /* src_program_h */
@@ -1,15 +1,180 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
 
+#include "../../common.h"
+#include "../../../include/gk/gk.h"
+#include "../realtime/packet.h"
 
-GkRenderItem*
-gkAllocRenderQueue(int32_t count) {
-  GkRenderItem* itemList;
+#include <string.h>
 
-  itemList = malloc(sizeof(*itemList) * count);
-  return itemList;
+/*
+ draw order of a render list is decided by a 64-bit key per item, items are
+ sorted by LSD radix sort, 8 bits per pass. Passes which all keys fall into
+ same bucket are skipped, so constant fields cost nothing.
+
+   pass is 1 for transparent items, so a mixed list draws opaque ones first
+
+   state:          pass:4 | pipeline:12 | material:16 | vao:16 | depth:16
+   front-to-back:  pass:4 | depth:16 | pipeline:12 | material:16 | vao:16
+   back-to-front:  same as front-to-back but depth is inverted
+ */
+
+typedef struct GkQueueItem {
+  uint64_t    key;
+  GkPrimInst *item;
+} GkQueueItem;
+
+/* scratch buffers, render lists are sorted on render thread */
+static GkQueueItem *gk__queue;
+static size_t       gk__queueSize;
+
+static
+GK_INLINE
+uint64_t
+gk__queuePtrKey(void *ptr) {
+  uintptr_t p;
+
+  p = (uintptr_t)ptr >> 4;
+  return (uint64_t)(((uint32_t)p * 2654435761u) >> 16);
 }
 
+/* top bits of positive float keep its order, ~1% precision is enough */
+static
+GK_INLINE
+uint64_t
+gk__queueDepth(mat4 view, GkPrimInst * __restrict primInst) {
+  vec3     c;
+  float    z;
+  uint32_t bits;
+
+  glm_vec3_center(primInst->bbox[0], primInst->bbox[1], c);
+
+  z = -(view[0][2] * c[0] + view[1][2] * c[1] + view[2][2] * c[2]
+        + view[3][2]);
+
+  if (!(z > 0.0f))
+    return 0;
 
+  memcpy(&bits, &z, sizeof(bits));
+  return bits >> 16;
+}
+
+static
+GK_INLINE
+uint64_t
+gk__queueKey(GkScene      * __restrict scene,
+             mat4                      view,
+             GkPrimInst   * __restrict primInst,
+             GkSortPolicy              policy) {
+  GkDrawPacket *pkt;
+  uint64_t      state, depth;
+  uint64_t      pass, prog, mat, vao;
+
+  pass = prog = mat = 0;
+  if ((pkt = primInst->packet)) {
+    if (pkt->pass[0].prog)
+      prog = (uint64_t)pkt->pass[0].prog->progId & 0xFFF;
+    mat  = gk__queuePtrKey(pkt->material);
+    pass = pkt->isTransp;
+  }
+
+  vao   = (uint64_t)primInst->prim->vao & 0xFFFF;
+  state = (prog << 32) | (mat << 16) | vao;
+  depth = gk__queueDepth(view, primInst);
+
+  switch (policy) {
+    case GK_SORT_FRONT_TO_BACK:
+      return (pass << 60) | (depth << 44) | state;
+    case GK_SORT_BACK_TO_FRONT:
+      return (pass << 60) | ((0xFFFF - depth) << 44) | state;
+    default:
+      return (pass << 60) | (state << 16) | depth;
+  }
+}
+
+static
 void
-gkLinearizeScene(GkScene * __restrict scene) {
-  
+gk__queueRadixSort(GkQueueItem * __restrict a,
+                   GkQueueItem * __restrict b,
+                   size_t                   count,
+                   GkQueueItem ** __restrict sorted) {
+  GkQueueItem *src, *dst, *t;
+  size_t       hist[256], offs[256], i, sum;
+  uint32_t     shift, digit;
+
+  src = a;
+  dst = b;
+
+  for (shift = 0; shift < 64; shift += 8) {
+    memset(hist, 0, sizeof(hist));
+
+    for (i = 0; i < count; i++)
+      hist[(src[i].key >> shift) & 0xFF]++;
+
+    /* all keys have same digit, nothing to do in this pass */
+    if (hist[(src[0].key >> shift) & 0xFF] == count)
+      continue;
+
+    for (sum = 0, i = 0; i < 256; i++) {
+      offs[i] = sum;
+      sum    += hist[i];
+    }
+
+    for (i = 0; i < count; i++) {
+      digit              = (src[i].key >> shift) & 0xFF;
+      dst[offs[digit]++] = src[i];
+    }
+
+    t   = src;
+    src = dst;
+    dst = t;
+  }
+
+  *sorted = src;
+}
+
+GK_EXPORT
+void
+gkSortRenderList(GkScene      * __restrict scene,
+                 GkCamera     * __restrict cam,
+                 GkRenderList * __restrict rnlist,
+                 GkSortPolicy              policy) {
+  GkQueueItem *sorted;
+  GkPrimInst **items;
+  size_t       i, count;
+
+  if (policy == GK_SORT_NONE || !rnlist || (count = rnlist->count) < 2)
+    return;
+
+  if (gk__queueSize < count * 2) {
+    gk__queueSize = count * 2;
+    gk__queue     = realloc(gk__queue, sizeof(*gk__queue) * gk__queueSize);
+  }
+
+  items = rnlist->items;
+
+  for (i = 0; i < count; i++) {
+    gk__queue[i].key  = gk__queueKey(scene, cam->view, items[i], policy);
+    gk__queue[i].item = items[i];
+  }
+
+  gk__queueRadixSort(gk__queue, gk__queue + count, count, &sorted);
+
+  for (i = 0; i < count; i++)
+    items[i] = sorted[i].item;
 }
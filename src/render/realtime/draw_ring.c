@@ -0,0 +1,260 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../../common.h"
+#include "../../../include/gk/opt.h"
+#include "../../../include/gk/platform.h"
+#include "../../types/impl_scene.h"
+#include "../../types/impl_transform.h"
+
+#include "draw_ring.h"
+
+#include <string.h>
+
+#ifdef GK_DRAW_RING
+
+/*
+ ring is split to GK_RING_SECTIONS sections, each frame writes to next one
+ after waiting its fence so that GPU is never reading what CPU writes.
+ */
+#define GK_RING_SECTIONS     3
+#define GK_RING_SECTION_SIZE (1024 * 1024)
+
+/* std140 layout of DrawBlock: MVP, MV, M, NM (mat3), NMU; padded to vec4 */
+#define GK_RING_DRAW_SIZE    256
+#define GK_RING_CAMERA_SIZE  128
+
+typedef struct GkDrawRing {
+  uint8_t  *ptr;
+  GkScene  *scene;
+  GkCamera *cam;
+  GLsync    fences[GK_RING_SECTIONS];
+  size_t    head;
+  size_t    end;     /* end of current section */
+  uint32_t  section;
+  uint32_t  frame;
+  GLint     align;
+  GLuint    ubo;
+} GkDrawRing;
+
+static GkDrawRing gk__ring;
+
+bool
+gkDrawRingEnabled(void) {
+  return gk_opt(GK_OPT_TRANSFORM_UBO)
+         && gkPlatfomInfo(GK_PLI_BUFFER_STORAGE);
+}
+
+static
+_gk_hide
+bool
+gk__ringInit(GkDrawRing * __restrict ring) {
+  GLbitfield flags;
+  size_t     size;
+
+  flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  size  = GK_RING_SECTION_SIZE * GK_RING_SECTIONS;
+
+  glGenBuffers(1, &ring->ubo);
+  glBindBuffer(GL_UNIFORM_BUFFER, ring->ubo);
+  glBufferStorage(GL_UNIFORM_BUFFER, size, NULL, flags);
+
+  if (!(ring->ptr = glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags))) {
+    glDeleteBuffers(1, &ring->ubo);
+    ring->ubo = 0;
+    return false;
+  }
+
+  if ((ring->align = gkPlatfomInfo(GK_PLI_UBO_ALIGNMENT)) <= 0)
+    ring->align = 256;
+
+  ring->section = 0;
+  ring->head    = 0;
+  ring->end     = GK_RING_SECTION_SIZE;
+
+  return true;
+}
+
+/* fence what is written so far, then wait until GPU is done with next one */
+static
+_gk_hide
+void
+gk__ringNextSection(GkDrawRing * __restrict ring) {
+  GLsync fence;
+  GLenum res;
+
+  ring->fences[ring->section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  ring->section               = (ring->section + 1) % GK_RING_SECTIONS;
+
+  if ((fence = ring->fences[ring->section])) {
+    do {
+      res = glClientWaitSync(fence,
+                             GL_SYNC_FLUSH_COMMANDS_BIT,
+                             1000000000ull);
+    } while (res == GL_TIMEOUT_EXPIRED);
+
+    glDeleteSync(fence);
+    ring->fences[ring->section] = NULL;
+  }
+
+  ring->head = (size_t)ring->section * GK_RING_SECTION_SIZE;
+  ring->end  = ring->head + GK_RING_SECTION_SIZE;
+
+  /* bound camera record may be overwritten now, write it again */
+  ring->cam  = NULL;
+}
+
+static
+GK_INLINE
+size_t
+gk__ringAlloc(GkDrawRing * __restrict ring, size_t size) {
+  size_t off;
+
+  off = (ring->head + ring->align - 1) & ~((size_t)ring->align - 1);
+  if (off + size > ring->end) {
+    gk__ringNextSection(ring);
+    off = ring->head;
+  }
+
+  ring->head = off + size;
+
+  return off;
+}
+
+/* each frame starts with a new section and its camera record */
+void
+gkDrawRingCamera(GkScene  * __restrict scene,
+                 GkCamera * __restrict cam) {
+  GkDrawRing  *ring;
+  GkSceneImpl *sceneImpl;
+  size_t       off;
+
+  ring      = &gk__ring;
+  sceneImpl = (GkSceneImpl *)scene;
+
+  if (!ring->ptr && !gk__ringInit(ring))
+    return;
+
+  if (ring->scene    == scene
+      && ring->cam   == cam
+      && ring->frame == sceneImpl->frame)
+    return;
+
+  if (ring->scene != scene || ring->frame != sceneImpl->frame)
+    gk__ringNextSection(ring);
+
+  off = gk__ringAlloc(ring, GK_RING_CAMERA_SIZE);
+  memcpy(ring->ptr + off,      cam->viewProj, sizeof(mat4));
+  memcpy(ring->ptr + off + 64, cam->view,     sizeof(mat4));
+
+  glBindBufferRange(GL_UNIFORM_BUFFER,
+                    GK_UBO_CAMERA,
+                    ring->ubo,
+                    off,
+                    GK_RING_CAMERA_SIZE);
+
+  ring->scene = scene;
+  ring->cam   = cam;
+  ring->frame = sceneImpl->frame;
+}
+
+void
+gkDrawRingTransform(GkScene     * __restrict scene,
+                    GkCamera    * __restrict cam,
+                    GkTransform * __restrict trans) {
+  GkDrawRing       *ring;
+  GkFinalTransform *ftr;
+  uint8_t          *dst;
+  mat4              mvp, mv;
+  mat3              nm;
+  size_t            off, i;
+  int32_t           usenm;
+
+  ring = &gk__ring;
+
+  gkDrawRingCamera(scene, cam);
+  if (!ring->ptr)
+    return;
+
+  off = gk__ringAlloc(ring, GK_RING_DRAW_SIZE);
+  dst = ring->ptr + off;
+
+  /* ring is wrapped to next section */
+  if (!ring->cam)
+    gkDrawRingCamera(scene, cam);
+
+  if ((ftr = gkValidFinalTransform(trans, cam))) {
+    usenm = GK_FLG(trans->flags, GK_TRANSF_FMAT_NORMAT);
+
+    memcpy(dst,      ftr->mvp, sizeof(mat4));
+    memcpy(dst + 64, ftr->mv,  sizeof(mat4));
+
+    if (usenm)
+      glm_mat4_pick3(ftr->nm, nm);
+  } else {
+    glm_mul(cam->viewProj, trans->world, mvp);
+    glm_mul(cam->view,     trans->world, mv);
+
+    usenm = !glm_uniscaled(trans->world);
+
+    memcpy(dst,      mvp, sizeof(mat4));
+    memcpy(dst + 64, mv,  sizeof(mat4));
+
+    if (usenm) {
+      glm_mat4_pick3(mv, nm);
+      glm_mat3_inv(nm, nm);
+      glm_mat3_transpose(nm);
+    }
+  }
+
+  memcpy(dst + 128, trans->world, sizeof(mat4));
+
+  /* std140 mat3 columns are padded to vec4 */
+  if (usenm) {
+    for (i = 0; i < 3; i++)
+      memcpy(dst + 192 + i * 16, nm[i], sizeof(vec3));
+  }
+
+  memcpy(dst + 240, &usenm, sizeof(usenm));
+
+  glBindBufferRange(GL_UNIFORM_BUFFER,
+                    GK_UBO_DRAW,
+                    ring->ubo,
+                    off,
+                    GK_RING_DRAW_SIZE);
+}
+
+#else
+
+bool
+gkDrawRingEnabled(void) {
+  return false;
+}
+
+void
+gkDrawRingCamera(GkScene  * __restrict scene,
+                 GkCamera * __restrict cam) {
+}
+
+void
+gkDrawRingTransform(GkScene     * __restrict scene,
+                    GkCamera    * __restrict cam,
+                    GkTransform * __restrict trans) {
+}
+
+#endif
@@ -0,0 +1,56 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef rn_draw_ring_h
+#define rn_draw_ring_h
+
+#include "../../../include/gk/gk.h"
+
+#if defined(GL_VERSION_4_4) || defined(GL_ARB_buffer_storage)
+#  define GK_DRAW_RING 1
+#endif
+
+/* uniform block bindings, 1 and 2 are used by joints and morph targets */
+#define GK_UBO_CAMERA 3
+#define GK_UBO_DRAW   4
+
+/*!
+ * @brief generated shaders read transforms from CameraBlock and DrawBlock
+ *        instead of plain uniforms if this returns true
+ */
+bool
+gkDrawRingEnabled(void);
+
+/*!
+ * @brief binds camera record of current frame to CameraBlock, writes it if
+ *        frame, camera or ring section is changed
+ */
+void
+gkDrawRingCamera(GkScene  * __restrict scene,
+                 GkCamera * __restrict cam);
+
+/*!
+ * @brief writes transform record of a draw to persistent mapped ring buffer
+ *        and binds its range to DrawBlock, also see gkDrawRingCamera()
+ */
+void
+gkDrawRingTransform(GkScene     * __restrict scene,
+                    GkCamera    * __restrict cam,
+                    GkTransform * __restrict trans);
+
+#endif /* rn_draw_ring_h */
@@ -0,0 +1,226 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../../common.h"
+#include "../../../include/gk/opt.h"
+
+#include "instance.h"
+#include "material.h"
+#include "packet.h"
+#include "prim.h"
+
+#include <limits.h>
+
+#define GK_INST_BUFF_SIZE  (GK_INST_STRIDE * GK_INST_MAX_BATCH * 4)
+
+static GLuint gk__inst_vbo = UINT_MAX;
+static size_t gk__inst_off;
+
+static
+GK_INLINE
+bool
+gk__instLocsFree(GkVertexAttachment * __restrict va) {
+  return !va->lastInput || va->lastInput->attribLocation < GK_INST_ATTRIB_LOC;
+}
+
+bool
+gkInstanceEligible(GkPrimInst * __restrict primInst) {
+  GkDrawPacket       *pkt;
+  GkVertexAttachment *va;
+
+  if (!(pkt = primInst->packet)
+      || pkt->isTransp
+      || primInst->hasSkin
+      || primInst->hasMorph
+      || !gk__instLocsFree(&primInst->prim->vertex))
+    return false;
+
+  for (va = primInst->vertexAttachments; va; va = va->next) {
+    if (!gk__instLocsFree(va))
+      return false;
+  }
+
+  return true;
+}
+
+static
+GK_INLINE
+bool
+gk__instSame(GkPrimInst * __restrict a, GkPrimInst * __restrict b) {
+  return a->prim              == b->prim
+         && b->packet
+         && a->packet->material  == b->packet->material
+         && a->activeMaterial    == b->activeMaterial
+         && a->bindTexture       == b->bindTexture
+         && a->vertexAttachments == b->vertexAttachments
+         && !b->hasSkin
+         && !b->hasMorph;
+}
+
+/* streams instance data to a ring buffer, the range which is written is
+   never read by pending draws so it is mapped unsynchronized. Buffer is
+   orphaned when it wraps. */
+size_t
+gkInstanceUpload(GkPrimInst ** __restrict items, uint32_t count) {
+  float    *dst;
+  size_t    size, off;
+  uint32_t  i;
+
+  size = GK_INST_STRIDE * count;
+
+  if (gk__inst_vbo == UINT_MAX) {
+    glGenBuffers(1, &gk__inst_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, gk__inst_vbo);
+    glBufferData(GL_ARRAY_BUFFER, GK_INST_BUFF_SIZE, NULL, GL_STREAM_DRAW);
+    gk__inst_off = 0;
+  } else {
+    glBindBuffer(GL_ARRAY_BUFFER, gk__inst_vbo);
+  }
+
+  if (gk__inst_off + size > GK_INST_BUFF_SIZE) {
+    glBufferData(GL_ARRAY_BUFFER, GK_INST_BUFF_SIZE, NULL, GL_STREAM_DRAW);
+    gk__inst_off = 0;
+  }
+
+  off = gk__inst_off;
+  dst = glMapBufferRange(GL_ARRAY_BUFFER,
+                         off,
+                         size,
+                         GL_MAP_WRITE_BIT
+                         | GL_MAP_INVALIDATE_RANGE_BIT
+                         | GL_MAP_UNSYNCHRONIZED_BIT);
+  if (!dst)
+    return SIZE_MAX;
+
+  for (i = 0; i < count; i++) {
+    gkInstanceData(items[i]->trans, dst);
+    dst += GK_INST_FLOATS;
+  }
+
+  glUnmapBuffer(GL_ARRAY_BUFFER);
+  gk__inst_off += size;
+
+  return off;
+}
+
+void
+gkInstanceAttribs(GLuint vao, GLuint vbo, size_t off, bool enable) {
+  GLuint loc;
+  int    i;
+
+  glBindVertexArray(vao);
+
+  if (enable)
+    glBindBuffer(GL_ARRAY_BUFFER, vbo ? vbo : gk__inst_vbo);
+
+  for (i = 0; i < 7; i++) {
+    loc = GK_INST_ATTRIB_LOC + i;
+
+    if (!enable) {
+      glDisableVertexAttribArray(loc);
+      continue;
+    }
+
+    /* mat4 columns then mat3 columns */
+    glVertexAttribPointer(loc,
+                          i < 4 ? 4 : 3,
+                          GL_FLOAT,
+                          GL_FALSE,
+                          GK_INST_STRIDE,
+                          (char *)NULL + off
+                          + (i < 4 ? i * 16 : 64 + (i - 4) * 12));
+    glVertexAttribDivisor(loc, 1);
+    glEnableVertexAttribArray(loc);
+  }
+}
+
+size_t
+gkRenderInstanced(GkScene     * __restrict scene,
+                  GkPrimInst ** __restrict prims,
+                  size_t                   count,
+                  size_t      * __restrict scanned) {
+  GkPrimInst   *batch[GK_INST_MAX_BATCH];
+  GkSceneImpl  *sceneImpl;
+  GkPrimInst   *first, *pi;
+  GkDrawPacket *pkt;
+  size_t        i, off;
+  uint32_t      frame, n;
+
+  sceneImpl = (GkSceneImpl *)scene;
+  first     = prims[0];
+
+  /* nothing in this list can be batched */
+  *scanned = count;
+  if (count < 2
+      || !gk_opt(GK_OPT_INSTANCING)
+      || scene->renderPrimFunc
+      || sceneImpl->overridePass
+      || GK_FLG(scene->flags, GK_SCENEF_SHADOWS)
+      || GK_FLG(scene->flags, GK_SCENEF_DRAW_PRIM_BBOX))
+    return 0;
+
+  *scanned = 1;
+  if (!gkInstanceEligible(first))
+    return 0;
+
+  frame = sceneImpl->frame;
+  n     = 0;
+
+  for (i = 0; i < count && n < GK_INST_MAX_BATCH; i++) {
+    pi = prims[i];
+
+    if (i > 0 && !gk__instSame(first, pi))
+      break;
+
+    pkt = pi->packet;
+
+    /* occluded in this frame */
+    if (pkt->occludedFrame == frame)
+      continue;
+
+    /* needs its own conditional render, ends the run */
+    if (pkt->condFrame == frame) {
+      if (i == 0)
+        return 0;
+      break;
+    }
+
+    batch[n++] = pi;
+  }
+
+  /* whole run is examined, don't scan it again for its remaining items */
+  *scanned = i;
+  if (n < 2)
+    return 0;
+
+  /* instanced pipeline may still be compiling, draw them one by one */
+  sceneImpl->instanceCount = n;
+  if (!gkDrawPacketPass(scene, sceneImpl->forLight, batch[0])
+      || (off = gkInstanceUpload(batch, n)) == SIZE_MAX) {
+    sceneImpl->instanceCount = 0;
+    return 0;
+  }
+
+  gkInstanceAttribs(batch[0]->prim->vao, 0, off, true);
+  gkRenderPrimInst(scene, batch[0]);
+  gkInstanceAttribs(batch[0]->prim->vao, 0, 0, false);
+
+  sceneImpl->instanceCount = 0;
+
+  return i;
+}
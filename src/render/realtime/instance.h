@@ -0,0 +1,92 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef rn_instance_h
+#define rn_instance_h
+
+#include "../../../include/gk/gk.h"
+#include <string.h>
+
+/* first attrib location of per instance data, locations below are free for
+   vertex inputs: mat4 model at 9..12, mat3 normal matrix at 13..15 */
+#define GK_INST_ATTRIB_LOC 9
+
+/* per instance data: world mat4 + normal mat3 */
+#define GK_INST_FLOATS     25
+#define GK_INST_STRIDE     (GK_INST_FLOATS * sizeof(float))
+
+/* max items in one batch */
+#define GK_INST_MAX_BATCH  1024
+
+/* world matrix then normal matrix, GK_INST_FLOATS floats */
+GK_INLINE
+void
+gkInstanceData(GkTransform * __restrict trans, float * __restrict dst) {
+  mat3 nm;
+
+  glm_mat4_pick3(trans->world, nm);
+  if (!glm_uniscaled(trans->world)) {
+    glm_mat3_inv(nm, nm);
+    glm_mat3_transpose(nm);
+  }
+
+  memcpy(dst,      trans->world, sizeof(mat4));
+  memcpy(dst + 16, nm,           sizeof(mat3));
+}
+
+/*!
+ * @brief returns true if prim instance can be drawn in an instanced batch,
+ *        its packet must be resolved
+ */
+bool
+gkInstanceEligible(GkPrimInst * __restrict primInst);
+
+/*!
+ * @brief writes world and normal matrices of items to instance buffer
+ *
+ * @return byte offset of first item in buffer, SIZE_MAX on failure
+ */
+size_t
+gkInstanceUpload(GkPrimInst ** __restrict items, uint32_t count);
+
+/*!
+ * @brief enables/disables per instance attribs of vao, instance data starts
+ *        at byte offset off of vbo (0: instance buffer). vao is left bound.
+ */
+void
+gkInstanceAttribs(GLuint vao, GLuint vbo, size_t off, bool enable);
+
+/*!
+ * @brief draws a run of render list items which share same primitive and
+ *        material with one instanced draw call
+ *
+ * @param[in]  scene    scene
+ * @param[in]  prims    render list items, first one starts the run
+ * @param[in]  count    remaining items in render list
+ * @param[out] scanned  number of items examined, when nothing is drawn
+ *                      caller must not try to batch them again this frame
+ *
+ * @return number of consumed items, 0 if they must be drawn alone
+ */
+size_t
+gkRenderInstanced(GkScene     * __restrict scene,
+                  GkPrimInst ** __restrict prims,
+                  size_t                   count,
+                  size_t      * __restrict scanned);
+
+#endif /* rn_instance_h */
@@ -24,6 +24,7 @@
 #include "../../default/def_effect.h"
 
 #include "material.h"
+#include "packet.h"
 #include "pass.h"
 #include "light.h"
 #include "prim.h"
@@ -62,33 +63,12 @@ gkApplyMaterial(GkScene    * __restrict scene,
                 GkPrimInst * __restrict primInst) {
   GkSceneImpl *sceneImpl;
   GkPass      *pass;
-  GkMaterial  *material;
 
   sceneImpl = (GkSceneImpl *)scene;
-  if (sceneImpl->overridePass) {
-    pass = sceneImpl->overridePass;
-    goto apply;
-  }
-
-  material = primInst->activeMaterial;
-
-  /*
-  if (!(pass = material->technique->pass)
-       && !(material->technique->pass =
-            pass = gkGetOrCreatPass(scene,
-                                    sceneImpl->forLight,
-                                    primInst,
-                                    material)))
-  */
-
-  /* TODO: CACHE generated program */
-  if (!(pass = gkGetOrCreatPass(scene,
-                                sceneImpl->forLight,
-                                primInst,
-                                material)))
+  if (!(pass = sceneImpl->overridePass)
+      && !(pass = gkDrawPacketPass(scene, sceneImpl->forLight, primInst)))
     return;
 
-apply:
   while (pass) {
     gkRenderPass(scene, primInst, pass);
     pass = pass->next;
@@ -0,0 +1,178 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../../common.h"
+#include "../../../include/gk/opt.h"
+#include "../../../include/gk/platform.h"
+
+#include "mdi.h"
+#include "mega.h"
+#include "instance.h"
+#include "material.h"
+#include "packet.h"
+#include "prim.h"
+
+#include <limits.h>
+
+#ifdef GK_MULTI_DRAW_INDIRECT
+
+static GLuint gk__mdi_buff = UINT_MAX;
+
+static
+_gk_hide
+bool
+gk__mdiEligible(GkPrimInst * __restrict primInst) {
+  GkDrawPacket *pkt;
+
+  return (pkt = primInst->packet)
+         && !pkt->isTransp
+         && !primInst->hasSkin
+         && !primInst->hasMorph
+         && !primInst->vertexAttachments
+         && gkMegaAllocFor(primInst->prim);
+}
+
+static
+GK_INLINE
+bool
+gk__mdiSame(GkPrimInst * __restrict a, GkPrimInst * __restrict b) {
+  return b->packet
+         && a->packet->material  == b->packet->material
+         && a->activeMaterial    == b->activeMaterial
+         && a->bindTexture       == b->bindTexture
+         && a->prim->mode        == b->prim->mode
+         && gk__mdiEligible(b)
+         && a->prim->mega->layout == b->prim->mega->layout;
+}
+
+size_t
+gkRenderMultiDraw(GkScene     * __restrict scene,
+                  GkPrimInst ** __restrict prims,
+                  size_t                   count,
+                  size_t      * __restrict scanned) {
+  GkDrawElementsIndirect cmds[GK_INST_MAX_BATCH];
+  GkPrimInst            *batch[GK_INST_MAX_BATCH];
+  GkSceneImpl           *sceneImpl;
+  GkPrimInst            *first, *pi;
+  GkDrawPacket          *pkt;
+  GkMegaAlloc           *mega;
+  GkMegaLayout          *layout;
+  size_t                 i, off;
+  uint32_t               frame, n;
+
+  sceneImpl = (GkSceneImpl *)scene;
+  first     = prims[0];
+
+  /* nothing in this list can be batched */
+  *scanned = count;
+  if (count < 2
+      || !gk_opt(GK_OPT_MULTI_DRAW)
+      || !gkPlatfomInfo(GK_PLI_MULTI_DRAW)
+      || scene->renderPrimFunc
+      || sceneImpl->overridePass
+      || GK_FLG(scene->flags, GK_SCENEF_SHADOWS)
+      || GK_FLG(scene->flags, GK_SCENEF_DRAW_PRIM_BBOX))
+    return 0;
+
+  *scanned = 1;
+  if (!gk__mdiEligible(first))
+    return 0;
+
+  frame = sceneImpl->frame;
+  n     = 0;
+
+  for (i = 0; i < count && n < GK_INST_MAX_BATCH; i++) {
+    pi = prims[i];
+
+    if (i > 0 && !gk__mdiSame(first, pi))
+      break;
+
+    pkt = pi->packet;
+
+    /* occluded in this frame */
+    if (pkt->occludedFrame == frame)
+      continue;
+
+    /* needs its own conditional render, ends the run */
+    if (pkt->condFrame == frame) {
+      if (i == 0)
+        return 0;
+      break;
+    }
+
+    mega = pi->prim->mega;
+
+    cmds[n].count         = pi->prim->count;
+    cmds[n].instanceCount = 1;
+    cmds[n].firstIndex    = mega->firstIndex;
+    cmds[n].baseVertex    = mega->baseVertex;
+    cmds[n].baseInstance  = n;
+
+    batch[n++] = pi;
+  }
+
+  /* whole run is examined, don't scan it again for its remaining items */
+  *scanned = i;
+  if (n < 2)
+    return 0;
+
+  /* uses the instanced pipeline, per draw transforms are instance attribs */
+  sceneImpl->instanceCount = n;
+  if (!gkDrawPacketPass(scene, sceneImpl->forLight, batch[0])
+      || (off = gkInstanceUpload(batch, n)) == SIZE_MAX) {
+    sceneImpl->instanceCount = 0;
+    return 0;
+  }
+
+  if (gk__mdi_buff == UINT_MAX)
+    glGenBuffers(1, &gk__mdi_buff);
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, gk__mdi_buff);
+  glBufferData(GL_DRAW_INDIRECT_BUFFER,
+               sizeof(*cmds) * n,
+               cmds,
+               GL_STREAM_DRAW);
+
+  layout = batch[0]->prim->mega->layout;
+  gkInstanceAttribs(layout->vao, 0, off, true);
+
+  sceneImpl->multiDrawCount  = n;
+  sceneImpl->multiDrawOffset = 0;
+  gkApplyMaterial(scene, batch[0]);
+  sceneImpl->multiDrawCount = 0;
+
+  gkInstanceAttribs(layout->vao, 0, 0, false);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+  sceneImpl->instanceCount = 0;
+
+  return i;
+}
+
+#else
+
+size_t
+gkRenderMultiDraw(GkScene     * __restrict scene,
+                  GkPrimInst ** __restrict prims,
+                  size_t                   count,
+                  size_t      * __restrict scanned) {
+  *scanned = count;
+  return 0;
+}
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef rn_mdi_h
+#define rn_mdi_h
+
+#include "../../../include/gk/gk.h"
+
+#if defined(GL_VERSION_4_3) || defined(GL_ARB_multi_draw_indirect)
+#  define GK_MULTI_DRAW_INDIRECT 1
+#endif
+
+typedef struct GkDrawElementsIndirect {
+  GLuint count;
+  GLuint instanceCount;
+  GLuint firstIndex;
+  GLint  baseVertex;
+  GLuint baseInstance;  /* selects per draw data in instance buffer */
+} GkDrawElementsIndirect;
+
+/*!
+ * @brief draws a run of render list items which share material and vertex
+ *        format with one glMultiDrawElementsIndirect call, vertices come
+ *        from shared buffers (see mega.h)
+ *
+ * @param[in]  scene    scene
+ * @param[in]  prims    render list items, first one starts the run
+ * @param[in]  count    remaining items in render list
+ * @param[out] scanned  number of items examined, when nothing is drawn
+ *                      caller must not try to batch them again this frame
+ *
+ * @return number of consumed items, 0 if they must be drawn otherwise
+ */
+size_t
+gkRenderMultiDraw(GkScene     * __restrict scene,
+                  GkPrimInst ** __restrict prims,
+                  size_t                   count,
+                  size_t      * __restrict scanned);
+
+#endif /* rn_mdi_h */
@@ -0,0 +1,296 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../../common.h"
+#include "../../../include/gk/vertex.h"
+#include "mega.h"
+
+#include <string.h>
+
+#define GK_MEGA_MIN_VERTS   (1 << 16)
+#define GK_MEGA_MIN_INDICES (1 << 18)
+
+static GkMegaLayout *gk__mega_layouts;
+static GkMegaAlloc   gk__mega_none; /* prims which can't be shared */
+
+static
+GK_INLINE
+GLsizei
+gk__megaTypeSize(GLenum type) {
+  switch (type) {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:  return 1;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:     return 2;
+    case GL_INT:
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:          return 4;
+    default:                return 0;
+  }
+}
+
+/* only tightly packed inputs at 0..n-1 can be copied as they are */
+static
+_gk_hide
+uint32_t
+gk__megaDesc(GkPrimitive   * __restrict prim,
+             GkMegaAttrib  * __restrict attribs,
+             GkGPUAccessor **           accs,
+             uint32_t      * __restrict vertCount) {
+  GkVertexInputBind *inp;
+  GkGPUAccessor     *acc;
+  GkMegaAttrib      *attr;
+  uint32_t           i;
+
+  if (!(prim->flags & GK_DRAW_ELEMENTS))
+    return 0;
+
+  *vertCount = 0;
+
+  for (i = 0, inp = prim->vertex.firstInput; inp; inp = inp->next, i++) {
+    if (i >= GK_INST_ATTRIB_LOC
+        || inp->attribLocation != (int32_t)i
+        || !inp->enabled
+        || !(acc = inp->input->accessor)
+        || !acc->buffer)
+      return 0;
+
+    attr            = &attribs[i];
+    attr->name      = inp->input->name;
+    attr->itemType  = acc->itemType;
+    attr->itemCount = acc->itemCount;
+    attr->elemSize  = acc->itemCount * gk__megaTypeSize(acc->itemType);
+    attr->integer   = gkAccessorIsInteger(acc);
+    attr->vbo       = 0;
+    accs[i]         = acc;
+
+    if (attr->elemSize == 0
+        || (acc->byteStride != 0 && acc->byteStride != (size_t)attr->elemSize)
+        || (i > 0 && acc->count != *vertCount))
+      return 0;
+
+    *vertCount = acc->count;
+  }
+
+  return i;
+}
+
+static
+_gk_hide
+GkMegaLayout*
+gk__megaLayoutFor(GkMegaAttrib * __restrict attribs, uint32_t attribCount) {
+  GkMegaLayout *layout;
+  GkMegaAttrib *a, *b;
+  uint32_t      i;
+
+  for (layout = gk__mega_layouts; layout; layout = layout->next) {
+    if (layout->attribCount != attribCount)
+      continue;
+
+    for (i = 0; i < attribCount; i++) {
+      a = &layout->attribs[i];
+      b = &attribs[i];
+
+      if (a->itemType     != b->itemType
+          || a->itemCount != b->itemCount
+          || a->integer   != b->integer
+          || strcmp(a->name, b->name) != 0)
+        break;
+    }
+
+    if (i == attribCount)
+      return layout;
+  }
+
+  layout              = calloc(1, sizeof(*layout));
+  layout->attribCount = attribCount;
+  layout->next        = gk__mega_layouts;
+  gk__mega_layouts    = layout;
+
+  memcpy(layout->attribs, attribs, sizeof(*attribs) * attribCount);
+  glGenVertexArrays(1, &layout->vao);
+
+  return layout;
+}
+
+/* buffers are replaced when they grow, old contents are copied on GPU */
+static
+_gk_hide
+GLuint
+gk__megaGrow(GLuint old, size_t used, size_t size) {
+  GLuint buf;
+
+  glGenBuffers(1, &buf);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buf);
+  glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STATIC_DRAW);
+
+  if (old) {
+    if (used > 0) {
+      glBindBuffer(GL_COPY_READ_BUFFER, old);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER,
+                          GL_COPY_WRITE_BUFFER,
+                          0,
+                          0,
+                          used);
+    }
+    glDeleteBuffers(1, &old);
+  }
+
+  return buf;
+}
+
+static
+_gk_hide
+void
+gk__megaBindVAO(GkMegaLayout * __restrict layout) {
+  GkMegaAttrib *attr;
+  uint32_t      i;
+
+  glBindVertexArray(layout->vao);
+
+  for (i = 0; i < layout->attribCount; i++) {
+    attr = &layout->attribs[i];
+
+    glBindBuffer(GL_ARRAY_BUFFER, attr->vbo);
+
+    if (attr->integer)
+      glVertexAttribIPointer(i, attr->itemCount, attr->itemType, 0, NULL);
+    else
+      glVertexAttribPointer(i,
+                            attr->itemCount,
+                            attr->itemType,
+                            GL_FALSE,
+                            0,
+                            NULL);
+
+    glEnableVertexAttribArray(i);
+  }
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, layout->ibo);
+  glBindVertexArray(0);
+}
+
+static
+_gk_hide
+void
+gk__megaReserve(GkMegaLayout * __restrict layout,
+                uint32_t                  vertCount,
+                uint32_t                  indexCount) {
+  GkMegaAttrib *attr;
+  uint32_t      cap, i;
+  bool          changed;
+
+  changed = false;
+
+  if (layout->vertexCount + vertCount > layout->vertexCapacity) {
+    cap = layout->vertexCapacity * 2;
+    cap = cap > GK_MEGA_MIN_VERTS ? cap : GK_MEGA_MIN_VERTS;
+    if (cap < layout->vertexCount + vertCount)
+      cap = layout->vertexCount + vertCount;
+
+    for (i = 0; i < layout->attribCount; i++) {
+      attr      = &layout->attribs[i];
+      attr->vbo = gk__megaGrow(attr->vbo,
+                               (size_t)layout->vertexCount * attr->elemSize,
+                               (size_t)cap * attr->elemSize);
+    }
+
+    layout->vertexCapacity = cap;
+    changed                = true;
+  }
+
+  if (layout->indexCount + indexCount > layout->indexCapacity) {
+    cap = layout->indexCapacity * 2;
+    cap = cap > GK_MEGA_MIN_INDICES ? cap : GK_MEGA_MIN_INDICES;
+    if (cap < layout->indexCount + indexCount)
+      cap = layout->indexCount + indexCount;
+
+    layout->ibo           = gk__megaGrow(layout->ibo,
+                                         layout->indexCount * sizeof(GLuint),
+                                         cap * sizeof(GLuint));
+    layout->indexCapacity = cap;
+    changed               = true;
+  }
+
+  if (changed)
+    gk__megaBindVAO(layout);
+}
+
+GkMegaAlloc*
+gkMegaAllocFor(GkPrimitive * __restrict prim) {
+  GkMegaAttrib   attribs[GK_INST_ATTRIB_LOC];
+  GkGPUAccessor *accs[GK_INST_ATTRIB_LOC];
+  GkMegaLayout  *layout;
+  GkMegaAlloc   *alloc;
+  GkMegaAttrib  *attr;
+  GLint          srcIbo;
+  uint32_t       attribCount, vertCount, i;
+
+  if (prim->mega)
+    return prim->mega->layout ? prim->mega : NULL;
+
+  prim->mega = &gk__mega_none;
+
+  if (!(attribCount = gk__megaDesc(prim, attribs, accs, &vertCount))
+      || vertCount == 0
+      || prim->count <= 0)
+    return NULL;
+
+  /* index buffer is only known by primitive's VAO */
+  srcIbo = 0;
+  glBindVertexArray(prim->vao);
+  glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &srcIbo);
+  glBindVertexArray(0);
+
+  if (!srcIbo)
+    return NULL;
+
+  layout = gk__megaLayoutFor(attribs, attribCount);
+  gk__megaReserve(layout, vertCount, prim->count);
+
+  for (i = 0; i < attribCount; i++) {
+    attr = &layout->attribs[i];
+
+    glBindBuffer(GL_COPY_READ_BUFFER,  accs[i]->buffer->vbo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, attr->vbo);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER,
+                        GL_COPY_WRITE_BUFFER,
+                        accs[i]->byteOffset,
+                        (size_t)layout->vertexCount * attr->elemSize,
+                        (size_t)vertCount * attr->elemSize);
+  }
+
+  glBindBuffer(GL_COPY_READ_BUFFER,  srcIbo);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, layout->ibo);
+  glCopyBufferSubData(GL_COPY_READ_BUFFER,
+                      GL_COPY_WRITE_BUFFER,
+                      0,
+                      layout->indexCount * sizeof(GLuint),
+                      prim->count * sizeof(GLuint));
+
+  alloc             = calloc(1, sizeof(*alloc));
+  alloc->layout     = layout;
+  alloc->firstIndex = layout->indexCount;
+  alloc->baseVertex = layout->vertexCount;
+
+  layout->vertexCount += vertCount;
+  layout->indexCount  += prim->count;
+
+  return prim->mega = alloc;
+}
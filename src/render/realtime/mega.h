@@ -0,0 +1,65 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef rn_mega_h
+#define rn_mega_h
+
+#include "../../../include/gk/gk.h"
+#include "instance.h"
+
+/*
+ static vertex and index data of primitives are copied to shared buffers,
+ one set of buffers per vertex format so that one VAO can draw all of them.
+ */
+
+typedef struct GkMegaAttrib {
+  const char *name;
+  GLuint      vbo;
+  GLenum      itemType;
+  GLint       itemCount;
+  GLsizei     elemSize;    /* bytes per vertex */
+  bool        integer;
+} GkMegaAttrib;
+
+typedef struct GkMegaLayout {
+  struct GkMegaLayout *next;
+  GkMegaAttrib         attribs[GK_INST_ATTRIB_LOC];
+  uint32_t             attribCount;
+  GLuint               vao;
+  GLuint               ibo;
+  uint32_t             vertexCount;
+  uint32_t             vertexCapacity;
+  uint32_t             indexCount;
+  uint32_t             indexCapacity;
+} GkMegaLayout;
+
+typedef struct GkMegaAlloc {
+  GkMegaLayout *layout;   /* NULL: primitive can't be shared */
+  uint32_t      firstIndex;
+  uint32_t      baseVertex;
+} GkMegaAlloc;
+
+/*!
+ * @brief copies vertex and index data of primitive to shared buffers once
+ *
+ * @return range of primitive in shared buffers, NULL if it can't be shared
+ */
+GkMegaAlloc*
+gkMegaAllocFor(GkPrimitive * __restrict prim);
+
+#endif /* rn_mega_h */
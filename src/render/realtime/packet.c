@@ -0,0 +1,159 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../../common.h"
+#include "../../../include/gk/gk.h"
+#include "../../../include/gk/material.h"
+#include "../../../include/gk/opt.h"
+#include "../../../include/gk/vertex.h"
+#include "../../shader/cmn_material.h"
+#include "../../shader/builtin_shader.h"
+#include "../../types/impl_scene.h"
+
+#include "packet.h"
+#include "transp.h"
+
+#include <string.h>
+
+#define GK_PACKET_SCENEF (GK_SCENEF_SHADOWS | GK_SCENEF_TRANSP)
+
+static GkPass gk__fallbackPass;
+
+uint32_t gk__pipelineGen = 1;
+
+void
+gkInvalidatePipelines(void) {
+  gk__pipelineGen++;
+}
+
+static
+GK_INLINE
+uint32_t
+gk__packetLightSlot(GkScene * __restrict scene,
+                    GkLight * __restrict light) {
+  return light
+         && light->type == GK_LIGHT_TYPE_POINT
+         && GK_FLG(scene->flags, GK_SCENEF_SHADOWS);
+}
+
+/* draw opaque prims with a plain pipeline while the real one is compiling,
+   only for first light because others are blended additively */
+static
+_gk_hide
+GkPass*
+gk__packetFallback(GkScene      * __restrict scene,
+                   GkLight      * __restrict light,
+                   GkDrawPacket * __restrict pkt,
+                   GkPrimInst   * __restrict primInst) {
+  GkVertexInputBind *inp;
+
+  if (gk_opt(GK_OPT_SHADER_COMPILE) != GK_SHADER_COMPILE_ASYNC_FALLBACK
+      || pkt->isTransp
+      || (light && light != (GkLight *)scene->lights)
+      || !(inp = primInst->prim->vertex.firstInput)
+      || inp->attribLocation != 0
+      || strcmp(inp->input->name, "POSITION") != 0)
+    return NULL;
+
+  if (!gk__fallbackPass.prog) {
+    if (!(gk__fallbackPass.prog = gkBuiltinProg(GK_BUILTIN_PROG_FALLBACK)))
+      return NULL;
+
+    gk__fallbackPass.noLights    = true;
+    gk__fallbackPass.noMaterials = true;
+  }
+
+  return &gk__fallbackPass;
+}
+
+GkDrawPacket*
+gkDrawPacketFor(GkScene        * __restrict scene,
+                GkGeometryInst * __restrict geomInst,
+                GkPrimInst     * __restrict primInst) {
+  GkDrawPacket *pkt;
+  GkMaterial   *mat;
+  uint32_t      sceneFlags;
+
+  if (!(pkt = primInst->packet))
+    pkt = primInst->packet = calloc(1, sizeof(*pkt));
+
+  mat        = gkMaterialFor(scene, geomInst, primInst);
+  sceneFlags = scene->flags & GK_PACKET_SCENEF;
+
+  if (pkt->material           != mat
+      || pkt->materialVersion != mat->version
+      || pkt->sceneFlags      != sceneFlags
+      || pkt->pipelineGen     != gk__pipelineGen) {
+    pkt->material        = mat;
+    pkt->materialVersion = mat->version;
+    pkt->sceneFlags      = sceneFlags;
+    pkt->pipelineGen     = gk__pipelineGen;
+    pkt->isTransp        = gkIsTransparent(scene, mat);
+    pkt->validPasses     = 0;
+
+    /* draw it on CPU path until GPU culling groups are rebuilt */
+    if (pkt->gpuCullGen) {
+      pkt->gpuCullGen = 0;
+      ((GkSceneImpl *)scene)->gpuCullDirty = true;
+    }
+  }
+
+  return pkt;
+}
+
+GkPass*
+gkDrawPacketPass(GkScene    * __restrict scene,
+                 GkLight    * __restrict light,
+                 GkPrimInst * __restrict primInst) {
+  GkDrawPacket *pkt;
+  GkPass       *pass;
+  uint32_t      slot, bit;
+  bool          inst;
+
+  if (!(pkt = primInst->packet) || pkt->pipelineGen != gk__pipelineGen)
+    pkt = gkDrawPacketFor(scene, primInst->geomInst, primInst);
+
+  if (pkt->vertexVersion != primInst->vertexVersion
+      || pkt->vao        != primInst->prim->vao) {
+    pkt->vertexVersion = primInst->vertexVersion;
+    pkt->vao           = primInst->prim->vao;
+    pkt->validPasses   = 0;
+  }
+
+  inst = ((GkSceneImpl *)scene)->instanceCount > 0;
+  slot = gk__packetLightSlot(scene, light);
+  pass = inst ? &pkt->instPass[slot] : &pkt->pass[slot];
+  bit  = 1 << (inst ? slot + GK_PACKET_LIGHT_SLOTS : slot);
+
+  if (!(pkt->validPasses & bit)) {
+    pass->prog        = gkGetPiplineForCmnMat(scene,
+                                              light,
+                                              primInst,
+                                              pkt->material);
+    pkt->validPasses |= bit;
+  }
+
+  if (!pass->prog)
+    return NULL;
+
+  /* fallback can't draw instances, caller draws them one by one */
+  if (!gkPipelineIsReady(pass->prog))
+    return inst ? NULL : gk__packetFallback(scene, light, pkt, primInst);
+
+  return pass;
+}
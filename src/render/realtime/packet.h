@@ -0,0 +1,82 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef rn_packet_h
+#define rn_packet_h
+
+#include "../../../include/gk/gk.h"
+#include "../../../include/gk/material.h"
+#include "../../../include/gk/pass.h"
+
+/* pipelines only differ by light for point light shadows (cube map) */
+#define GK_PACKET_LIGHT_SLOTS 2
+
+/*
+ everything is needed to draw a primitive instance, resolved once and reused
+ until material, scene flags (shadows, transparency), light type or vertex
+ attachments are changed.
+ */
+typedef struct GkDrawPacket {
+  GkMaterial *material;
+  GkPass      pass[GK_PACKET_LIGHT_SLOTS];
+  GkPass      instPass[GK_PACKET_LIGHT_SLOTS]; /* for instanced batches */
+  GLuint      vao;
+  uint32_t    materialVersion;
+  uint32_t    vertexVersion;
+  uint32_t    pipelineGen;   /* gk__pipelineGen passes are resolved for   */
+  uint32_t    sceneFlags;
+  uint32_t    occludedFrame; /* hidden in main pass if it is current frame */
+  uint32_t    condFrame;     /* drawn with conditional render              */
+  uint32_t    queryFrame;
+  uint32_t    gpuCullGen;    /* drawn by GPU culling if scene's gen       */
+  GLuint      query;
+
+  /* interned input layout of shader key, see gkShaderKeyFor() */
+  uint64_t    layoutId;
+  GkMaterial *layoutMat;
+  void       *layoutInput;  /* last vertex input of prim */
+  void       *layoutBindTex[4];
+  uint32_t    layoutMatVersion;
+  uint32_t    layoutVertexVersion;
+  uint32_t    layoutGen;
+  bool        layoutTransp;
+
+  uint8_t     validPasses;   /* instanced ones after GK_PACKET_LIGHT_SLOTS */
+  bool        isTransp;
+} GkDrawPacket;
+
+/*
+ bumped when a global which selects pipelines is changed: options, shadow or
+ transparency technique; packets resolve their pipelines again.
+ */
+extern uint32_t gk__pipelineGen;
+
+void
+gkInvalidatePipelines(void);
+
+GkDrawPacket*
+gkDrawPacketFor(GkScene        * __restrict scene,
+                GkGeometryInst * __restrict geomInst,
+                GkPrimInst     * __restrict primInst);
+
+GkPass*
+gkDrawPacketPass(GkScene    * __restrict scene,
+                 GkLight    * __restrict light,
+                 GkPrimInst * __restrict primInst);
+
+#endif /* rn_packet_h */
@@ -27,6 +27,7 @@
 #include "material.h"
 #include "pass.h"
 #include "prim.h"
+#include "draw_ring.h"
 
 void
 gkRenderPass(GkScene    * __restrict scene,
@@ -38,6 +39,7 @@ gkRenderPass(GkScene    * __restrict scene,
   GkTransform *trans;
   GkPrimitive *prim;
   GkMaterial  *material;
+  GkCamera    *cam;
 
   if (!(prog = pass->prog))
     return;
@@ -47,6 +49,7 @@ gkRenderPass(GkScene    * __restrict scene,
   prim      = primInst->prim;
   trans     = primInst->trans;
   material  = primInst->activeMaterial;
+  cam       = scene->camera;
 
   gkUseProgram(ctx, prog);
 
@@ -55,7 +58,19 @@ gkRenderPass(GkScene    * __restrict scene,
     gkToggleDoubleSided(ctx, material->doubleSided);
   }
 
-  gkUniformTransform(prog, trans, scene->camera);
+  /* one range bind instead of uniform calls */
+  if (prog->drawBlock)
+    gkDrawRingTransform(scene, cam, trans);
+  else
+    gkUniformTransform(prog, trans, cam);
+
+  /* model matrices are instance attributes, view is shared */
+  if (sceneImpl->instanceCount > 0) {
+    if (gkDrawRingEnabled())
+      gkDrawRingCamera(scene, cam);
+    else
+      gkUniformMat4(gkUniformLoc(prog, "V"), cam->view);
+  }
 
   if (!pass->noLights) {
     switch (sceneImpl->rpath) {
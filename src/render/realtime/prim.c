@@ -19,11 +19,41 @@
 #include "../../common.h"
 #include "prim.h"
 #include "material.h"
+#include "mdi.h"
 #include "../../../include/gk/prims/cube.h"
 
 void
 gkRenderPrim(GkScene     * __restrict scene,
              GkPrimitive * __restrict prim) {
+  GkSceneImpl *sceneImpl;
+  GLsizei      instc;
+
+  sceneImpl = (GkSceneImpl *)scene;
+
+#ifdef GK_MULTI_DRAW_INDIRECT
+  /* commands are in bound GL_DRAW_INDIRECT_BUFFER */
+  if (sceneImpl->multiDrawCount > 0) {
+    glMultiDrawElementsIndirect(prim->mode,
+                                GL_UNSIGNED_INT,
+                                (char *)NULL + sceneImpl->multiDrawOffset,
+                                sceneImpl->multiDrawCount,
+                                0);
+    return;
+  }
+#endif
+
+  if ((instc = sceneImpl->instanceCount) > 0) {
+    if (prim->flags & GK_DRAW_ELEMENTS)
+      glDrawElementsInstanced(prim->mode,
+                              prim->count,
+                              GL_UNSIGNED_INT,
+                              NULL,
+                              instc);
+    else if (prim->flags & GK_DRAW_ARRAYS)
+      glDrawArraysInstanced(prim->mode, 0, prim->count, instc);
+    return;
+  }
+
   if (prim->flags & GK_DRAW_ELEMENTS)
     glDrawElements(prim->mode,
                    prim->count,
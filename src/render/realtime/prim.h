@@ -20,6 +20,10 @@
 #define rn_prim_h
 
 #include "../../../include/gk/gk.h"
+#include "../../types/impl_scene.h"
+#include "packet.h"
+#include "instance.h"
+#include "mdi.h"
 
 void
 gkRenderPrim(GkScene     * __restrict scene,
@@ -33,17 +37,57 @@ GK_INLINE
 void
 gkRenderPrims(GkScene      * __restrict scene,
               GkRenderList * __restrict rnlist) {
-  GkPrimInst **prims;
-  size_t       i, primc;
+  GkPrimInst  **prims;
+  GkDrawPacket *pkt;
+  size_t        i, primc, batched, scanned, mdiEnd, instEnd;
+  uint32_t      frame;
+  bool          cond;
 
   primc     = rnlist->count;
   prims     = rnlist->items;
+  frame     = ((GkSceneImpl *)scene)->frame;
+  mdiEnd    = instEnd = 0;
 
   for (i = 0; i < primc; i++) {
+    /* same material (and prim) in a row, draw them at once; a run which
+       could not be batched is not scanned again for its remaining items */
+    if (i >= mdiEnd) {
+      if ((batched = gkRenderMultiDraw(scene, &prims[i], primc - i,
+                                       &scanned)) > 0) {
+        i += batched - 1;
+        continue;
+      }
+      mdiEnd = i + scanned;
+    }
+
+    if (i >= instEnd) {
+      if ((batched = gkRenderInstanced(scene, &prims[i], primc - i,
+                                       &scanned)) > 0) {
+        i += batched - 1;
+        continue;
+      }
+      instEnd = i + scanned;
+    }
+
+    cond = false;
+
+    if ((pkt = prims[i]->packet)) {
+      /* occluded in this frame */
+      if (pkt->occludedFrame == frame)
+        continue;
+
+      /* query result is not ready yet, let GPU decide without waiting */
+      if ((cond = pkt->condFrame == frame))
+        glBeginConditionalRender(pkt->query, GL_QUERY_NO_WAIT);
+    }
+
     if (!scene->renderPrimFunc)
       gkRenderPrimInst(scene, prims[i]);
     else
       scene->renderPrimFunc(scene, prims[i]);
+
+    if (cond)
+      glEndConditionalRender();
   }
 }
 
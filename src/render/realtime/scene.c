@@ -25,7 +25,9 @@
 #include "../../default/def_light.h"
 #include "../../../include/gk/gpu_state.h"
 #include "../../../include/gk/clear.h"
+#include "../../../include/gk/opt.h"
 #include "../../bbox/scene_bbox.h"
+#include "../../culling/frustum_gpu.h"
 #include "prim.h"
 #include "animator.h"
 
@@ -52,6 +54,7 @@ gkDefRenderFunc(GkScene * scene) {
                scene->bbox,
                scene->rootNode->trans->world);
 
+  gkRenderGPUCulled(scene);
   gkRenderPrims(scene, frustum->opaque);
   gkRenderPrims(scene, frustum->transp);
 
@@ -116,7 +119,6 @@ gkRenderScene(GkScene * scene) {
   scene->flags &= ~GK_SCENEF_RENDERED;
   scene->flags |= GK_SCENEF_RENDERING;
 
-  glm_aabb_invalidate(scene->bbox);
   if (!GK_FLG(scene->flags, GK_SCENEF_PREPARED))
     gkPrepareScene(scene);
 
@@ -142,13 +144,33 @@ gkRenderScene(GkScene * scene) {
 
   /* todo: use frustum culler here */
   if (!(scene->trans->flags & GK_TRANSF_WORLD_ISVALID))
-    gkApplyTransform(scene, scene->rootNode);
+    gkMarkNodeDirty(scene, scene->rootNode);
+
+  /* animated nodes are only marked, update them once */
+  gkFlushTransforms(scene);
 
-  if ((scene->camera->flags & GK_UPDT_VIEWPROJ))
+  /* lights of shown layers may be stale */
+  if ((scene->camera->flags & GK_UPDT_VIEWPROJ)
+      || sceneImpl->viewHiddenLayers != scene->hiddenLayers)
     gkApplyView(scene, scene->rootNode);
 
-  /* frustum culling */
+  /* frustum culling, prims which are culled on GPU are skipped on CPU */
+  sceneImpl->frame++;
+  gkCullFrustumGPU(scene, scene->camera);
   gkCullFrustum(scene, scene->camera);
+
+  if (sceneImpl->occlusionMode != GK_OCCLUSION_NONE)
+    gkCullOcclusion(scene, scene->camera);
+
+  /* main pass, transparency and shadow passes draw in this order */
+  gkSortRenderList(scene,
+                   scene->camera,
+                   scene->camera->frustum.opaque,
+                   (GkSortPolicy)gk_opt(GK_OPT_SORT_OPAQUE));
+  gkSortRenderList(scene,
+                   scene->camera,
+                   scene->camera->frustum.transp,
+                   (GkSortPolicy)gk_opt(GK_OPT_SORT_TRANSP));
   
   /* this can be combined with CullFrustum but it easy to magane in this way */
   gkPerModelInstTask(scene, scene->camera->frustum.modelInsList);
@@ -162,6 +184,9 @@ gkRenderScene(GkScene * scene) {
 
   sceneImpl->rp(scene);
 
+  if (sceneImpl->occlusionMode == GK_OCCLUSION_GPU)
+    gkIssueOcclusionQueries(scene, scene->camera);
+
   scene->flags &= ~GK_SCENEF_UPDT_LIGHTS;
   scene->flags &= ~GK_SCENEF_NEEDS_RENDER;
   scene->flags &= ~GK_SCENEF_RENDERING;
@@ -0,0 +1,291 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../../common.h"
+#include "../../../include/gk/gk.h"
+#include "../../../include/gk/scene.h"
+#include "../../../include/gk/program.h"
+#include "../../../include/gk/opt.h"
+#include "../../types/impl_scene.h"
+#include "../../shader/cmn_material.h"
+
+#include "packet.h"
+#include "instance.h"
+
+#include <tm/tm.h>
+#include <stdlib.h>
+
+#define GK_WARMUP_MAX_LIGHTS 8
+
+typedef struct GkWarmupVariant {
+  GkShaderVariantInfo info;
+  GkPipeline         *prog;
+  bool                isNew;
+} GkWarmupVariant;
+
+typedef struct GkWarmupState {
+  GkWarmupVariant *items;
+  uint64_t        *keys;     /* open addressing set, 0 is empty slot */
+  uint32_t         count;
+  uint32_t         size;
+  uint32_t         keysSize; /* power of two */
+  GkShaderCompileMode mode;
+} GkWarmupState;
+
+static
+GK_INLINE
+uint32_t
+gk__warmupHash(uint64_t key) {
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdull;
+  key ^= key >> 33;
+
+  return (uint32_t)key;
+}
+
+static
+_gk_hide
+uint64_t*
+gk__warmupSlot(uint64_t *keys, uint32_t size, uint64_t key) {
+  uint32_t mask, i;
+
+  mask = size - 1;
+  i    = gk__warmupHash(key) & mask;
+
+  while (keys[i] && keys[i] != key)
+    i = (i + 1) & mask;
+
+  return &keys[i];
+}
+
+/* keys are never 0, layout id in high bits starts from 1 */
+static
+_gk_hide
+bool
+gk__warmupSeen(GkWarmupState * __restrict st, uint64_t key) {
+  uint64_t *keys, *slot;
+  uint32_t  size, i;
+
+  /* keep load factor under 0.75 */
+  if ((st->count + 1) * 4 > st->keysSize * 3) {
+    size = st->keysSize ? st->keysSize * 2 : 64;
+    keys = calloc(size, sizeof(*keys));
+
+    for (i = 0; i < st->keysSize; i++) {
+      if (st->keys[i])
+        *gk__warmupSlot(keys, size, st->keys[i]) = st->keys[i];
+    }
+
+    free(st->keys);
+    st->keys     = keys;
+    st->keysSize = size;
+  }
+
+  slot = gk__warmupSlot(st->keys, st->keysSize, key);
+  if (*slot)
+    return true;
+
+  *slot = key;
+  return false;
+}
+
+static
+_gk_hide
+void
+gk__warmupPrim(GkScene       * __restrict scene,
+               GkLight       * __restrict light,
+               GkPrimInst    * __restrict primInst,
+               GkWarmupState * __restrict st) {
+  GkWarmupVariant     *var;
+  GkDrawPacket        *pkt;
+  GkProgramCacheStats  stats;
+  uint64_t             key;
+  uint32_t             hits;
+  double               start;
+
+  pkt = gkDrawPacketFor(scene, primInst->geomInst, primInst);
+  if (!pkt->material || !pkt->material->technique)
+    return;
+
+  key = gkShaderKeyFor(scene, light, primInst, pkt->material);
+  if (gk__warmupSeen(st, key))
+    return;
+
+  if (st->count == st->size) {
+    st->size  = st->size ? st->size * 2 : 32;
+    st->items = realloc(st->items, st->size * sizeof(*st->items));
+  }
+
+  var = &st->items[st->count++];
+  var->info.key    = key;
+  var->info.time   = 0.0;
+  var->info.cached = false;
+  var->info.failed = false;
+  var->isNew       = false;
+
+  /* already created e.g. by previous warm-up or rendering */
+  if ((var->prog = gkGetPipelineByKey(key, NULL, NULL)))
+    return;
+
+  gkProgramCacheStats(&stats);
+  hits  = stats.hits;
+  start = tm_time();
+
+  var->prog      = gkGetPiplineForCmnMatMode(scene,
+                                             light,
+                                             primInst,
+                                             pkt->material,
+                                             st->mode);
+  var->info.time = tm_time() - start;
+  var->isNew     = true;
+
+  gkProgramCacheStats(&stats);
+  var->info.cached = stats.hits != hits;
+  var->info.failed = !var->prog;
+}
+
+/* instanced and multi draw batches use their own variants */
+static
+_gk_hide
+bool
+gk__warmupBatches(GkScene * __restrict scene) {
+  return (gk_opt(GK_OPT_INSTANCING) || gk_opt(GK_OPT_MULTI_DRAW))
+         && !scene->renderPrimFunc
+         && !((GkSceneImpl *)scene)->overridePass
+         && !GK_FLG(scene->flags, GK_SCENEF_SHADOWS)
+         && !GK_FLG(scene->flags, GK_SCENEF_DRAW_PRIM_BBOX);
+}
+
+GK_EXPORT
+void
+gkWarmupShaders(GkScene              * __restrict scene,
+                bool                              parallel,
+                GkShaderWarmupReport * __restrict report) {
+  GkSceneImpl     *sceneImpl;
+  GkNodeCompList  *renderables;
+  GkGeometryInst  *geomInst;
+  GkLight         *light, *lights[GK_WARMUP_MAX_LIGHTS];
+  GkPrimInst      *primInst;
+  GkWarmupVariant *var;
+  GkWarmupState    st;
+  double           start, waitStart;
+  uint32_t         i, j, k, nLights;
+  bool             batches;
+  int32_t          p;
+
+  sceneImpl = (GkSceneImpl *)scene;
+  start     = tm_time();
+
+  if (!GK_FLG(scene->flags, GK_SCENEF_PREPARED))
+    gkPrepareScene(scene);
+
+  /* variants only differ by light type, one light per type is enough */
+  nLights = 0;
+  light   = (GkLight *)scene->lights;
+  while (light && nLights < GK_WARMUP_MAX_LIGHTS) {
+    for (k = 0; k < nLights; k++) {
+      if (lights[k]->type == light->type)
+        break;
+    }
+
+    if (k == nLights)
+      lights[nLights++] = light;
+
+    light = (GkLight *)light->ref.next;
+  }
+
+  /* builds are issued together and waited below if parallel */
+  st.mode = (GkShaderCompileMode)gk_opt(GK_OPT_SHADER_COMPILE);
+  if (parallel && st.mode == GK_SHADER_COMPILE_SYNC)
+    st.mode = GK_SHADER_COMPILE_ASYNC_SKIP;
+
+  st.items    = NULL;
+  st.keys     = NULL;
+  st.count    = st.size = 0;
+  st.keysSize = 0;
+
+  batches = gk__warmupBatches(scene);
+
+  /* instances of other nodes are renderables too, only visit node's own */
+  renderables = &sceneImpl->comps[GK_NODE_COMP_RENDERABLE];
+  for (i = 0; i < renderables->count; i++) {
+    geomInst = renderables->items[i].item;
+
+    for (p = 0; p < geomInst->primc; p++) {
+      primInst = &geomInst->prims[p];
+
+      for (k = 0; k < nLights; k++)
+        gk__warmupPrim(scene, lights[k], primInst, &st);
+
+      /* packet is resolved above */
+      if (!batches || !gkInstanceEligible(primInst))
+        continue;
+
+      sceneImpl->instanceCount = 1;
+      for (k = 0; k < nLights; k++)
+        gk__warmupPrim(scene, lights[k], primInst, &st);
+      sceneImpl->instanceCount = 0;
+    }
+  }
+
+  free(st.keys);
+
+  /* all builds are issued, now wait them in order */
+  for (j = 0; j < st.count; j++) {
+    var = &st.items[j];
+    if (!var->isNew || !var->prog)
+      continue;
+
+    waitStart        = tm_time();
+    var->info.failed = !gkPipelineWait(var->prog);
+    var->info.time  += tm_time() - waitStart;
+  }
+
+  if (!report) {
+    free(st.items);
+    return;
+  }
+
+  report->count     = st.count;
+  report->created   = 0;
+  report->cached    = 0;
+  report->failed    = 0;
+  report->variants  = NULL;
+  report->totalTime = tm_time() - start;
+
+  if (st.count > 0)
+    report->variants = malloc(st.count * sizeof(*report->variants));
+
+  for (j = 0; j < st.count; j++) {
+    var                  = &st.items[j];
+    report->variants[j]  = var->info;
+    report->created     += var->isNew;
+    report->cached      += var->info.cached;
+    report->failed      += var->info.failed;
+  }
+
+  free(st.items);
+}
+
+GK_EXPORT
+void
+gkFreeWarmupReport(GkShaderWarmupReport * __restrict report) {
+  free(report->variants);
+  report->variants = NULL;
+  report->count    = 0;
+}
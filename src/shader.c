@@ -60,17 +60,14 @@ gkShaderLogInfo(GLuint shaderId,
 }
 
 GLuint
-gkShaderLoad(GLenum shaderType,
-             const char * source) {
-  FILE  *logFile;
+gkShaderCompile(GLenum shaderType,
+                const char * source) {
   GLuint shaderId;
-  GLint  status;
 
-  logFile  = stderr;
   shaderId = glCreateShader(shaderType);
 
   if(shaderId == 0) {
-    fprintf(logFile, "Couldn't create shader!");
+    fprintf(stderr, "Couldn't create shader!");
     return shaderId;
   }
 
@@ -79,8 +76,23 @@ gkShaderLoad(GLenum shaderType,
                  (const GLchar **)&source,
                  NULL);
 
+  /* don't query status here, driver may compile it in background */
   glCompileShader(shaderId);
 
+  return shaderId;
+}
+
+GLuint
+gkShaderLoad(GLenum shaderType,
+             const char * source) {
+  FILE  *logFile;
+  GLuint shaderId;
+  GLint  status;
+
+  logFile = stderr;
+  if ((shaderId = gkShaderCompile(shaderType, source)) == 0)
+    return shaderId;
+
   glGetShaderiv(shaderId,
                 GL_COMPILE_STATUS,
                 &status);
@@ -95,20 +107,18 @@ gkShaderLoad(GLenum shaderType,
   return shaderId;
 }
 
-GLuint
-gkShaderLoadN(GLenum  shaderType,
-              char   *source[],
-              size_t  count) {
+static
+char*
+gk__shaderConcat(char *source[], size_t count) {
   char  *src;
   size_t i, len;
-  GLuint ret;
 
   len = 0;
   for (i = 0; i < count; i++)
     len += strlen(source[i]);
 
   if (len == 0)
-    return -1;
+    return NULL;
 
   src = malloc(len + 1);
   src[0] = src[len] = '\0';
@@ -116,12 +126,41 @@ gkShaderLoadN(GLenum  shaderType,
   for (i = 0; i < count; i++)
     strcat(src, source[i]);
 
+  return src;
+}
+
+GLuint
+gkShaderLoadN(GLenum  shaderType,
+              char   *source[],
+              size_t  count) {
+  char  *src;
+  GLuint ret;
+
+  if (!(src = gk__shaderConcat(source, count)))
+    return -1;
+
   ret = gkShaderLoad(shaderType, src);
   free(src);
 
   return ret;
 }
 
+GLuint
+gkShaderCompileN(GLenum  shaderType,
+                 char   *source[],
+                 size_t  count) {
+  char  *src;
+  GLuint ret;
+
+  if (!(src = gk__shaderConcat(source, count)))
+    return -1;
+
+  ret = gkShaderCompile(shaderType, src);
+  free(src);
+
+  return ret;
+}
+
 GLuint
 gkShaderLoadFromFile(GLenum shaderType,
                      const char * path) {
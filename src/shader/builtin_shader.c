@@ -117,6 +117,41 @@ gkBuiltinProg(GkBuiltinProg progtype) {
 
       return gkGetOrCreatProgByName("clr_grad_circ", src, typ, 2, 0);
     }
+    case GK_BUILTIN_PROG_FALLBACK: {
+      const char *src[2];
+      GLenum      typ[2] = {
+        GL_VERTEX_SHADER,
+        GL_FRAGMENT_SHADER
+      };
+
+      src[0] =
+#include "glsl/vert/shadowmap.glsl"
+      ;
+
+      src[1] =
+#include "glsl/frag/fallback.glsl"
+      ;
+
+      return gkGetOrCreatProgByName("builtin_fallback",
+                                    src,
+                                    typ,
+                                    2,
+                                    GK_SHADER_FLAG_MVP);
+    }
+#ifdef GL_COMPUTE_SHADER
+    case GK_BUILTIN_PROG_CULL_FRUSTUM: {
+      const char *src[1];
+      GLenum      typ[1] = {
+        GL_COMPUTE_SHADER
+      };
+
+      src[0] =
+#include "glsl/comp/cull_frustum.glsl"
+      ;
+
+      return gkGetOrCreatProgByName("builtin_cull_frustum", src, typ, 1, 0);
+    }
+#endif
     default:
       break;
   }
@@ -31,7 +31,13 @@ typedef enum GkBuiltinProg {
   GK_BUILTIN_PROG_WEIGBL_COMPOS = 4,
 
   /* Clear Effects */
-  GK_BUILTIN_PROG_CLR_GRAD_CIRC = 5
+  GK_BUILTIN_PROG_CLR_GRAD_CIRC = 5,
+
+  /* used while real pipeline is compiling */
+  GK_BUILTIN_PROG_FALLBACK      = 6,
+
+  /* compute, GL 4.3 */
+  GK_BUILTIN_PROG_CULL_FRUSTUM  = 7
 } GkBuiltinProg;
 
 GkPipeline*
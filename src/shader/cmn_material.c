@@ -25,11 +25,18 @@
 #include "../../include/gk/vertex.h"
 #include "../../include/gk/shadows.h"
 #include "../../include/gk/transparent.h"
+#include "../../include/gk/opt.h"
 #include "../render/realtime/transp.h"
+#include "../program/binary_cache.h"
+#include "../types/impl_scene.h"
+#include "../render/realtime/draw_ring.h"
+#include "../render/realtime/packet.h"
 #include <ds/forward-list-sep.h>
+#include <ds/rb.h>
 
 #include <malloc/malloc.h>
 #include <string.h>
+#include <tm/tm.h>
 
 #define _DF(X)  "\n#define " X "\n"
 #define SH_V_ARG(F, ...) flg->vert += sprintf(flg->vert, _DF(F), __VA_ARGS__);
@@ -55,6 +62,11 @@ typedef struct GkFlagsStruct {
   int   texCount;
 } GkFlagsStruct;
 
+static
+const char*
+gk__texCoordName(GkPrimInst * __restrict primInst,
+                 GkTexture  * __restrict tex);
+
 static
 void
 gk__texFlag(GkPrimInst    * __restrict primInst,
@@ -77,11 +89,22 @@ gk__fillAttribs(GkMaterial  * __restrict mat,
 
 static
 GkPipeline*
-gk_creatPiplForCmnMat(char *name, void *userData);
+gk_creatPiplForCmnMat(uint64_t key, void *userData);
+
+#define GK_NAME_APPEND(...)                                               \
+  do {                                                                    \
+    if (len < size) {                                                     \
+      int n_;                                                             \
+      if ((n_ = snprintf(nameBuff + len, size - len, __VA_ARGS__)) > 0)   \
+        len += (size_t)n_;                                                \
+    }                                                                     \
+  } while (0)
 
 static
-char*
-gk__updatename_va(char               * __restrict pname,
+size_t
+gk__updatename_va(char               * __restrict nameBuff,
+                  size_t                          len,
+                  size_t                          size,
                   GkVertexAttachment * __restrict va) {
   GkVertexInputBind *inpi;
   GkVertexInput     *inp;
@@ -95,12 +118,12 @@ gk__updatename_va(char               * __restrict pname,
     if (!shortName)
       shortName = inp->name;
 
-    pname += sprintf(pname, "%s", shortName);
+    GK_NAME_APPEND("%s", shortName);
     
     inpi = inpi->next;
   }
   
-  return pname;
+  return len;
 }
 
 size_t
@@ -108,45 +131,50 @@ gkShaderNameFor(GkScene     * __restrict scene,
                 GkLight     * __restrict light,
                 GkPrimInst  * __restrict primInst,
                 GkMaterial  * __restrict mat,
-                char        * __restrict nameBuff) {
+                char        * __restrict nameBuff,
+                size_t                   size) {
   GkPrimitive        *prim;
   GkTechnique        *techn;
-  char               *pname;
   GkColorDesc        *attr[4];
   GkVertexAttachment *va;
+  size_t              len;
   int32_t             i;
   char                prefix[] = "dsaert";
 
-  prim = primInst->prim;
+  if (size < 1)
+    return 0;
+
+  prim        = primInst->prim;
+  nameBuff[0] = '\0';
+  len         = 0;
 
   /*
    Shader Name: [TechniqueType]_[Inputs]_[Attribs]_[Extra...]
    */
 
-  pname = nameBuff;
   techn = mat->technique;
 
   memset(attr, 0, sizeof(attr));
   gk__fillAttribs(mat, attr, techn);
-  pname += sprintf(pname, "%d_", techn->type);
+  GK_NAME_APPEND("%d_", techn->type);
 
   /* primitive inputs */
-  va = &prim->vertex;
-  pname = gk__updatename_va(pname, va);
+  va  = &prim->vertex;
+  len = gk__updatename_va(nameBuff, len, size, va);
   
   if ((va = primInst->vertexAttachments)) {
     do {
-      pname = gk__updatename_va(pname, va);
+      len = gk__updatename_va(nameBuff, len, size, va);
     } while ((va = va->next));
   }
 
   /* Occlusion Map */
   if (techn->occlusion && techn->occlusion->tex)
-    pname += sprintf(pname, "_oc");
+    GK_NAME_APPEND("_oc");
 
   /* Normal Map */
   if (techn->normal && techn->normal->tex)
-    pname += sprintf(pname, "_n");
+    GK_NAME_APPEND("_n");
 
   /* PBR flags */
   switch (techn->type) {
@@ -156,10 +184,10 @@ gkShaderNameFor(GkScene     * __restrict scene,
       metalRough = (GkMetalRough *)techn;
 
       if (metalRough->albedoMap)
-        pname += sprintf(pname, "_a");
+        GK_NAME_APPEND("_a");
 
       if (metalRough->metalRoughMap)
-        pname += sprintf(pname, "_mr");
+        GK_NAME_APPEND("_mr");
 
       break;
     }
@@ -170,10 +198,10 @@ gkShaderNameFor(GkScene     * __restrict scene,
       specGloss = (GkSpecGloss *)techn;
 
       if (specGloss->diffuseMap)
-        pname += sprintf(pname, "_d");
+        GK_NAME_APPEND("_d");
 
       if (specGloss->specGlossMap)
-        pname += sprintf(pname, "_sg");
+        GK_NAME_APPEND("_sg");
       break;
     }
 
@@ -185,29 +213,335 @@ gkShaderNameFor(GkScene     * __restrict scene,
     if (!attr[i])
       continue;
 
-    pname += sprintf(pname, "%c%d", prefix[i], attr[i]->method);
+    GK_NAME_APPEND("%c%d", prefix[i], attr[i]->method);
   }
 
-  if (GK_FLG(scene->flags, GK_SCENEF_SHADOWS))
-    pname += sprintf(pname, "_shdw");
+  if (GK_FLG(scene->flags, GK_SCENEF_SHADOWS)) {
+    GK_NAME_APPEND("_shdw");
+
+    if (light && light->type == GK_LIGHT_TYPE_POINT)
+      GK_NAME_APPEND("_cube");
+  }
 
   if (gkIsTransparent(scene, mat)) {
     switch (gkTranspTechn()) {
       case GK_TRANSP_WEIGHTED_BLENDED:
-        pname += sprintf(pname, "_trsp_wbl");
+        GK_NAME_APPEND("_trsp_wbl");
         break;
       default:
-        pname += sprintf(pname, "_trsp");
+        GK_NAME_APPEND("_trsp");
         break;
     }
   }
 
   if (mat->technique->transparent
       && mat->technique->transparent->opaque == GK_OPAQUE_MASK)
-    pname += sprintf(pname, "_msk");
+    GK_NAME_APPEND("_msk");
+
+  if (((GkSceneImpl *)scene)->instanceCount > 0)
+    GK_NAME_APPEND("_inst");
+
+  if (gkDrawRingEnabled())
+    GK_NAME_APPEND("_ubo");
 
   /* TODO: transparent, reflectivity */
-  return nameBuff - pname;
+  return len < size ? len : size - 1;
+}
+
+/* buf is NULL if layout id is cached, nothing is appended then */
+typedef struct GkKeyDesc {
+  char  *buf;
+  size_t len;
+  size_t size;
+  bool   heap;
+} GkKeyDesc;
+
+typedef struct GkLayoutInfo {
+  char    *desc; /* key in gk__layouts */
+  uint64_t hash; /* stable across runs */
+} GkLayoutInfo;
+
+static RBTree       *gk__layouts;
+static GkLayoutInfo *gk__layoutInfos; /* by layout id */
+static uint32_t      gk__layoutInfosSize;
+static uint32_t      gk__layoutCount;
+
+static
+void
+gk__descAppend(GkKeyDesc  * __restrict desc,
+               const char * __restrict str) {
+  size_t n;
+
+  if (!desc->buf)
+    return;
+
+  n = strlen(str) + 1;
+  if (desc->len + n + 1 > desc->size) {
+    char *buf;
+
+    desc->size = (desc->len + n + 1) * 2;
+    if (desc->heap) {
+      buf = realloc(desc->buf, desc->size);
+    } else {
+      buf = malloc(desc->size);
+      memcpy(buf, desc->buf, desc->len);
+    }
+
+    desc->buf  = buf;
+    desc->heap = true;
+  }
+
+  memcpy(desc->buf + desc->len, str, n - 1);
+  desc->len += n;
+
+  desc->buf[desc->len - 1] = ';';
+  desc->buf[desc->len]     = '\0';
+}
+
+static
+void
+gk__descInputs(GkKeyDesc          * __restrict desc,
+               GkVertexAttachment * __restrict va) {
+  GkVertexInputBind *inpi;
+
+  if (!desc->buf)
+    return;
+
+  for (inpi = va->firstInput; inpi; inpi = inpi->next)
+    gk__descAppend(desc, inpi->input->name);
+}
+
+/*
+ layout ids live as long as the library. Distinct layouts are only distinct
+ sets of vertex input and texcoord names, which are a few per app, so ids are
+ not recycled; GK_SHKEY_LAYOUT_SHIFT leaves 24 bits for them.
+ */
+static
+uint64_t
+gk__layoutId(const char * __restrict desc) {
+  GkLayoutInfo *info;
+  void         *found;
+  uint64_t      hash;
+
+  if ((found = rb_find(gk__layouts, (void *)desc)))
+    return (uint64_t)(uintptr_t)found;
+
+  if (++gk__layoutCount >= gk__layoutInfosSize) {
+    gk__layoutInfosSize = gk__layoutInfosSize ? gk__layoutInfosSize * 2 : 64;
+    gk__layoutInfos     = realloc(gk__layoutInfos,
+                                  sizeof(*gk__layoutInfos)
+                                  * gk__layoutInfosSize);
+  }
+
+  info       = &gk__layoutInfos[gk__layoutCount];
+  info->desc = strdup(desc);
+
+  rb_insert(gk__layouts, info->desc, (void *)(uintptr_t)gk__layoutCount);
+
+  /* fnv-1a */
+  hash = 0xcbf29ce484222325ull;
+  while (*desc) {
+    hash ^= (unsigned char)*desc++;
+    hash *= 0x100000001b3ull;
+  }
+
+  info->hash = hash;
+
+  return gk__layoutCount;
+}
+
+/*
+ layout ids depend on the order layouts are first seen, they are replaced
+ with hash of layout so that same key names same shaders in every run.
+ */
+static
+_gk_hide
+uint64_t
+gk__diskKey(uint64_t key) {
+  uint64_t id, hash;
+
+  id   = key >> GK_SHKEY_LAYOUT_SHIFT;
+  hash = key & ((1ull << GK_SHKEY_LAYOUT_SHIFT) - 1);
+
+  if (id > 0 && id <= gk__layoutCount)
+    hash ^= gk__layoutInfos[id].hash * 0x9e3779b97f4a7c15ull;
+
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+
+  /* 0: don't cache */
+  return hash ? hash : 1;
+}
+
+uint64_t
+gkShaderKeyFor(GkScene     * __restrict scene,
+               GkLight     * __restrict light,
+               GkPrimInst  * __restrict primInst,
+               GkMaterial  * __restrict mat) {
+  GkTechnique        *techn;
+  GkTransparent      *transp;
+  GkColorDesc        *attr[4];
+  GkTexture          *tex[2];
+  GkVertexAttachment *va;
+  GkDrawPacket       *pkt;
+  GkKeyDesc           desc;
+  uint64_t            key;
+  int32_t             i;
+  bool                isTransp, cached;
+  char                buf[256];
+
+  /*
+   everything is packed into bits except names of vertex inputs and texture
+   coords, they are interned to a layout id. Inputs are ordered by attrib
+   location so they are kept in order.
+   */
+
+  techn     = mat->technique;
+  key       = (uint64_t)techn->type << GK_SHKEY_TECHN_SHIFT;
+  isTransp  = gkIsTransparent(scene, mat);
+  desc.buf  = buf;
+  desc.len  = 0;
+  desc.size = sizeof(buf);
+  desc.heap = false;
+  buf[0]    = '\0';
+
+  /* names only change with material, inputs, bound texcoords or
+     transparency */
+  cached = (pkt = primInst->packet)
+           && pkt->layoutId
+           && pkt->layoutGen           == gk__pipelineGen
+           && pkt->layoutMat           == mat
+           && pkt->layoutMatVersion    == mat->version
+           && pkt->layoutVertexVersion == primInst->vertexVersion
+           && pkt->layoutInput         == primInst->prim->vertex.lastInput
+           && pkt->layoutBindTex[0]    == primInst->bindTexture
+           && pkt->layoutBindTex[1]    == primInst->prim->bindTexture
+           && pkt->layoutBindTex[2]    == primInst->geomInst->bindTexture
+           && pkt->layoutBindTex[3]    == primInst->geomInst->geom->bindTexture
+           && pkt->layoutTransp        == isTransp;
+
+  if (cached)
+    desc.buf = NULL;
+
+  gk__descInputs(&desc, &primInst->prim->vertex);
+  for (va = primInst->vertexAttachments; va; va = va->next)
+    gk__descInputs(&desc, va);
+
+  gk__descAppend(&desc, "|");
+
+  memset(attr, 0, sizeof(attr));
+  gk__fillAttribs(mat, attr, techn);
+
+  for (i = 0; i < 4; i++) {
+    if (!attr[i])
+      continue;
+
+    key |= (uint64_t)(attr[i]->method + 1) << (GK_SHKEY_ATTR_SHIFT + i * 2);
+    if (attr[i]->method == GK_COLOR_TEX && attr[i]->val)
+      gk__descAppend(&desc, gk__texCoordName(primInst, attr[i]->val));
+  }
+
+  if (techn->occlusion && techn->occlusion->tex) {
+    key |= GK_SHKEY_OCCLUSION;
+    gk__descAppend(&desc, gk__texCoordName(primInst, techn->occlusion->tex));
+  }
+
+  if (techn->normal && techn->normal->tex) {
+    key |= GK_SHKEY_NORMALMAP;
+    gk__descAppend(&desc, gk__texCoordName(primInst, techn->normal->tex));
+  }
+
+  tex[0] = tex[1] = NULL;
+  switch (techn->type) {
+    case GK_MATERIAL_METALROUGH:
+      tex[0] = ((GkMetalRough *)techn)->albedoMap;
+      tex[1] = ((GkMetalRough *)techn)->metalRoughMap;
+      break;
+    case GK_MATERIAL_SPECGLOSS:
+      tex[0] = ((GkSpecGloss *)techn)->diffuseMap;
+      tex[1] = ((GkSpecGloss *)techn)->specGlossMap;
+      break;
+    default:
+      break;
+  }
+
+  for (i = 0; i < 2; i++) {
+    if (!tex[i])
+      continue;
+
+    key |= GK_SHKEY_PBRMAP0 << i;
+    gk__descAppend(&desc, gk__texCoordName(primInst, tex[i]));
+  }
+
+  if (GK_FLG(scene->flags, GK_SCENEF_SHADOWS)) {
+    key |= GK_SHKEY_SHADOWS;
+
+    if (gkShadowTechn() == GK_SHADOW_CSM) {
+      key |= GK_SHKEY_SHAD_CSM;
+      key |= (uint64_t)(gkShadowSplit() & GK_SHKEY_SPLIT_MASK)
+                << GK_SHKEY_SPLIT_SHIFT;
+    }
+
+    if (light && light->type == GK_LIGHT_TYPE_POINT)
+      key |= GK_SHKEY_SHAD_CUBE;
+  }
+
+  if (isTransp) {
+    transp = techn->transparent;
+    key   |= GK_SHKEY_TRANSP;
+
+    if (transp->color) {
+      key |= (uint64_t)(transp->color->method + 1) << GK_SHKEY_TRANSPC_SHIFT;
+      if (transp->color->method == GK_COLOR_TEX && transp->color->val)
+        gk__descAppend(&desc, gk__texCoordName(primInst, transp->color->val));
+    }
+
+    key |= (uint64_t)transp->opaque << GK_SHKEY_OPAQUE_SHIFT;
+
+    if (gkTranspTechn() == GK_TRANSP_WEIGHTED_BLENDED)
+      key |= GK_SHKEY_TRANSP_WBL;
+  }
+
+  if (techn->transparent && techn->transparent->opaque == GK_OPAQUE_MASK)
+    key |= GK_SHKEY_ALPHAMASK;
+
+  if (primInst->geomInst->skin)
+    key |= GK_SHKEY_SKIN;
+
+  if (primInst->hasMorph)
+    key |= GK_SHKEY_MORPH;
+
+  if (((GkSceneImpl *)scene)->instanceCount > 0)
+    key |= GK_SHKEY_INSTANCED;
+
+  if (gkDrawRingEnabled())
+    key |= GK_SHKEY_TRANSFORM_UBO;
+
+  if (cached)
+    return key | pkt->layoutId << GK_SHKEY_LAYOUT_SHIFT;
+
+  if (pkt) {
+    pkt->layoutId            = gk__layoutId(desc.buf);
+    pkt->layoutMat           = mat;
+    pkt->layoutMatVersion    = mat->version;
+    pkt->layoutVertexVersion = primInst->vertexVersion;
+    pkt->layoutGen           = gk__pipelineGen;
+    pkt->layoutInput         = primInst->prim->vertex.lastInput;
+    pkt->layoutBindTex[0]    = primInst->bindTexture;
+    pkt->layoutBindTex[1]    = primInst->prim->bindTexture;
+    pkt->layoutBindTex[2]    = primInst->geomInst->bindTexture;
+    pkt->layoutBindTex[3]    = primInst->geomInst->geom->bindTexture;
+    pkt->layoutTransp        = isTransp;
+    key                     |= pkt->layoutId << GK_SHKEY_LAYOUT_SHIFT;
+  } else {
+    key |= gk__layoutId(desc.buf) << GK_SHKEY_LAYOUT_SHIFT;
+  }
+
+  if (desc.heap)
+    free(desc.buf);
+
+  return key;
 }
 
 void
@@ -378,6 +712,14 @@ gkShaderFlagsFor(GkScene     * __restrict scene,
     
     SH_V_ARG("TARGET_COUNT %d", 2); /* TODO: */
   }
+
+  /* transforms come from instance attributes */
+  if (((GkSceneImpl *)scene)->instanceCount > 0)
+    SH_V("INSTANCED")
+
+  /* camera and per draw transforms come from ring buffer */
+  if (gkDrawRingEnabled())
+    SH_V("TRANSFORM_UBO")
   
   SH_VF_ARG("TEX_COUNT %d", flg->texCount)
 }
@@ -386,7 +728,8 @@ GkShader*
 gkShadersFor(GkScene     * __restrict scene,
              GkLight     * __restrict light,
              GkPrimInst  * __restrict primInst,
-             GkMaterial  * __restrict mat) {
+             GkMaterial  * __restrict mat,
+             GkShaderCompileMode      mode) {
   GkShader *vert, *frag;
   char     *fragSource[3], *vertSource[4];
 
@@ -451,12 +794,18 @@ gkShadersFor(GkScene     * __restrict scene,
 #include "glsl/vert/common.glsl"
   ;
   
-  vert->shaderId = gkShaderLoadN(vert->shaderType, vertSource, 4);
-
   frag = calloc(1, sizeof(*frag));
   frag->isValid    = 1;
   frag->shaderType = GL_FRAGMENT_SHADER;
-  frag->shaderId   = gkShaderLoadN(frag->shaderType, fragSource, 3);
+
+  /* status will be checked after link completed */
+  if (mode != GK_SHADER_COMPILE_SYNC) {
+    vert->shaderId = gkShaderCompileN(vert->shaderType, vertSource, 4);
+    frag->shaderId = gkShaderCompileN(frag->shaderType, fragSource, 3);
+  } else {
+    vert->shaderId = gkShaderLoadN(vert->shaderType, vertSource, 4);
+    frag->shaderId = gkShaderLoadN(frag->shaderType, fragSource, 3);
+  }
 
   vert->next = frag;
 
@@ -469,17 +818,30 @@ gkGetPiplineForCmnMat(GkScene    * __restrict scene,
                       GkLight    * __restrict light,
                       GkPrimInst * __restrict primInst,
                       GkMaterial * __restrict mat) {
-  char  name[64];
-  void *userData[4];
+  return gkGetPiplineForCmnMatMode(scene,
+                                   light,
+                                   primInst,
+                                   mat,
+                                   gk_opt(GK_OPT_SHADER_COMPILE));
+}
 
-  (void)gkShaderNameFor(scene, light, primInst, mat, name);
+GkPipeline*
+gkGetPiplineForCmnMatMode(GkScene    * __restrict scene,
+                          GkLight    * __restrict light,
+                          GkPrimInst * __restrict primInst,
+                          GkMaterial * __restrict mat,
+                          GkShaderCompileMode     mode) {
+  void *userData[5];
 
   userData[0] = scene;
   userData[1] = light;
   userData[2] = primInst;
   userData[3] = mat;
+  userData[4] = (void *)(uintptr_t)mode;
 
-  return gkGetPipeline(name, gk_creatPiplForCmnMat, userData);
+  return gkGetPipelineByKey(gkShaderKeyFor(scene, light, primInst, mat),
+                            gk_creatPiplForCmnMat,
+                            userData);
 }
 
 static
@@ -510,6 +872,9 @@ gk__beforeLink(GkPipeline *pip, void *data) {
   prim     = primInst->prim;
   va       = &prim->vertex;
 
+  if (gkProgramCacheEnabled())
+    glProgramParameteri(pip->progId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
   gk__bindVertAttachment(pip, va);
   
   if ((va = primInst->vertexAttachments)) {
@@ -521,55 +886,74 @@ gk__beforeLink(GkPipeline *pip, void *data) {
 
 static
 GkPipeline*
-gk_creatPiplForCmnMat(char *name, void *userData) {
+gk_creatPiplForCmnMat(uint64_t key, void *userData) {
   GkShader    *shaders;
   GkScene     *scene;
   GkPrimInst  *primInst;
   GkLight     *light;
   GkMaterial  *mat;
+  GkPipeline  *prog;
+  double       start;
+  uint64_t     diskKey;
+  GkShaderCompileMode mode;
+
+  diskKey = gk__diskKey(key);
+  if ((prog = gkProgramCacheLoad(diskKey)))
+    return prog;
 
   scene    = ((void **)userData)[0];
   light    = ((void **)userData)[1];
   primInst = ((void **)userData)[2];
   mat      = ((void **)userData)[3];
+  mode     = (GkShaderCompileMode)(uintptr_t)((void **)userData)[4];
+  start    = tm_time();
+
+  if (!(shaders = gkShadersFor(scene, light, primInst, mat, mode)))
+    return NULL;
+
+  if (mode != GK_SHADER_COMPILE_SYNC)
+    return gkNewPipelineAsync(shaders, gk__beforeLink, primInst, diskKey);
 
-  if ((shaders = gkShadersFor(scene, light, primInst, mat)))
-    return gkNewPipeline(shaders, gk__beforeLink, primInst);
+  prog = gkNewPipeline(shaders, gk__beforeLink, primInst);
+  gkProgramCacheStore(diskKey, prog, tm_time() - start);
 
-  return NULL;
+  return prog;
 }
 
 static
-void
-gk__texFlag(GkPrimInst    * __restrict primInst,
-            GkTexture     * __restrict tex,
-            char          * __restrict attrname,
-            GkFlagsStruct * __restrict flags) {
+const char*
+gk__texCoordName(GkPrimInst * __restrict primInst,
+                 GkTexture  * __restrict tex) {
   GkSampler     *sampler;
-  const char    *coordInpName;
   GkBindTexture *bindtex;
 
-  if (!tex)
-    return;
-
-  coordInpName = NULL;
-
   if ((bindtex = primInst->bindTexture)
       || (bindtex = primInst->prim->bindTexture)
       || (bindtex = primInst->geomInst->bindTexture)
       || (bindtex = primInst->geomInst->geom->bindTexture)
       || ((sampler = tex->sampler) && (bindtex = sampler->bindTexture))) {
     while (bindtex) {
-      if (bindtex->texture == tex) {
-        coordInpName = bindtex->coordInputName;
-        break;
-      }
+      if (bindtex->texture == tex)
+        return bindtex->coordInputName;
       bindtex = bindtex->next;
     }
   }
 
-  if (!coordInpName)
-    coordInpName = "TEXCOORD";
+  return "TEXCOORD";
+}
+
+static
+void
+gk__texFlag(GkPrimInst    * __restrict primInst,
+            GkTexture     * __restrict tex,
+            char          * __restrict attrname,
+            GkFlagsStruct * __restrict flags) {
+  const char *coordInpName;
+
+  if (!tex)
+    return;
+
+  coordInpName = gk__texCoordName(primInst, tex);
 
   flags->frag += sprintf(flags->frag,
                          "\n#define %s_TEX\n"
@@ -607,3 +991,28 @@ gk__fillAttribs(GkMaterial   * __restrict mat,
   matAttribs[2] = techn->ambient;
   matAttribs[3] = techn->emission;
 }
+
+void
+gk_cmnmat_init() {
+  gk__layouts = rb_newtree_str();
+}
+
+void
+gk_cmnmat_deinit() {
+  uint32_t i;
+
+  rb_destroy(gk__layouts);
+
+  for (i = 1; i <= gk__layoutCount; i++)
+    free(gk__layoutInfos[i].desc);
+
+  free(gk__layoutInfos);
+
+  gk__layouts         = NULL;
+  gk__layoutInfos     = NULL;
+  gk__layoutInfosSize = 0;
+  gk__layoutCount     = 0;
+
+  /* cached layout ids of packets are not valid anymore */
+  gkInvalidatePipelines();
+}
@@ -22,12 +22,46 @@
 #include "../../include/gk/gk.h"
 #include "../../include/gk/material.h"
 
+/*
+ shader variant key (see gkShaderKeyFor), low bits are features; vertex input
+ and texcoord names are interned to a layout id which is stored in high bits.
+ */
+#define GK_SHKEY_TECHN_SHIFT   0  /* 4 bits: technique type                */
+#define GK_SHKEY_ATTR_SHIFT    4  /* 4 x 2 bits: color method + 1 (dsae)   */
+#define GK_SHKEY_OCCLUSION     (1ull << 12)
+#define GK_SHKEY_NORMALMAP     (1ull << 13)
+#define GK_SHKEY_PBRMAP0       (1ull << 14)
+#define GK_SHKEY_PBRMAP1       (1ull << 15)
+#define GK_SHKEY_SHADOWS       (1ull << 16)
+#define GK_SHKEY_SHAD_CSM      (1ull << 17)
+#define GK_SHKEY_SHAD_CUBE     (1ull << 18)
+#define GK_SHKEY_TRANSP        (1ull << 19)
+#define GK_SHKEY_TRANSPC_SHIFT 20 /* 2 bits: transparent color method + 1 */
+#define GK_SHKEY_OPAQUE_SHIFT  22 /* 3 bits: GkOpaque                      */
+#define GK_SHKEY_TRANSP_WBL    (1ull << 25)
+#define GK_SHKEY_ALPHAMASK     (1ull << 26)
+#define GK_SHKEY_SKIN          (1ull << 27)
+#define GK_SHKEY_MORPH         (1ull << 28)
+#define GK_SHKEY_SPLIT_SHIFT   29 /* 4 bits: shadow split count            */
+#define GK_SHKEY_SPLIT_MASK    0xF
+#define GK_SHKEY_INSTANCED     (1ull << 33)
+#define GK_SHKEY_TRANSFORM_UBO (1ull << 34)
+#define GK_SHKEY_LAYOUT_SHIFT  40 /* 24 bits: interned input layout        */
+
+uint64_t
+gkShaderKeyFor(GkScene     * __restrict scene,
+               GkLight     * __restrict light,
+               GkPrimInst  * __restrict primInst,
+               GkMaterial  * __restrict mat);
+
+/* for debugging, pipelines are keyed by gkShaderKeyFor() */
 size_t
 gkShaderNameFor(GkScene     * __restrict scene,
                 GkLight     * __restrict light,
                 GkPrimInst  * __restrict primInst,
                 GkMaterial  * __restrict mat,
-                char        * __restrict nameBuff);
+                char        * __restrict nameBuff,
+                size_t                   size);
 
 void
 gkShaderFlagsFor(GkScene     * __restrict scene,
@@ -41,12 +75,27 @@ GkShader*
 gkShadersFor(GkScene     * __restrict scene,
              GkLight     * __restrict light,
              GkPrimInst  * __restrict primInst,
-             GkMaterial  * __restrict mat);
+             GkMaterial  * __restrict mat,
+             GkShaderCompileMode      mode);
 
+/* compiles with GK_OPT_SHADER_COMPILE if pipeline doesn't exist */
 GkPipeline*
 gkGetPiplineForCmnMat(GkScene    * __restrict scene,
                       GkLight    * __restrict light,
                       GkPrimInst * __restrict primInst,
                       GkMaterial * __restrict mat);
 
+GkPipeline*
+gkGetPiplineForCmnMatMode(GkScene    * __restrict scene,
+                          GkLight    * __restrict light,
+                          GkPrimInst * __restrict primInst,
+                          GkMaterial * __restrict mat,
+                          GkShaderCompileMode     mode);
+
+void
+gk_cmnmat_init(void);
+
+void
+gk_cmnmat_deinit(void);
+
 #endif /* cmn_material_h */
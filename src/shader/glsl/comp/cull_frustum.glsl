@@ -0,0 +1,82 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+GK_STRINGIFY(
+layout(local_size_x = 64) in;
+
+struct Draw {
+  uint slot;       /* box index                          */
+  uint count;
+  uint firstIndex;
+  int  baseVertex;
+  uint cmdBase;    /* first command of group             */
+  uint group;
+  uint pad0;
+  uint pad1;
+};
+
+/* six arrays: minx, miny, minz, maxx, maxy, maxz */
+layout(std430, binding = 0) readonly  buffer Boxes    { float boxes[];    };
+layout(std430, binding = 1) readonly  buffer Draws    { Draw  draws[];    };
+layout(std430, binding = 2) readonly  buffer InstIn   { float instIn[];   };
+layout(std430, binding = 3)           buffer Cmds     { uint  cmds[];     };
+layout(std430, binding = 4) writeonly buffer InstOut  { float instOut[];  };
+layout(std430, binding = 5)           buffer Counters { uint  counters[]; };
+
+uniform vec4 uPlanes[6];
+uniform uint uDrawCount;
+uniform uint uBoxStride;
+
+void main() {
+  Draw d;
+  vec3 bmin, bmax;
+  uint i, o, j, s;
+
+  i = gl_GlobalInvocationID.x;
+  if (i >= uDrawCount)
+    return;
+
+  d = draws[i];
+  s = uBoxStride;
+
+  bmin = vec3(boxes[d.slot], boxes[s + d.slot], boxes[2u * s + d.slot]);
+  bmax = vec3(boxes[3u * s + d.slot],
+              boxes[4u * s + d.slot],
+              boxes[5u * s + d.slot]);
+
+  /* farthest corner along plane normal, same as CPU culler */
+  for (j = 0u; j < 6u; j++) {
+    if (dot(max(uPlanes[j].xyz * bmin, uPlanes[j].xyz * bmax), vec3(1.0))
+          < -uPlanes[j].w)
+      return;
+  }
+
+  /* compact visible draws to the front of group's commands */
+  o = d.cmdBase + atomicAdd(counters[d.group], 1u);
+
+  cmds[o * 5u]      = d.count;
+  cmds[o * 5u + 1u] = 1u;
+  cmds[o * 5u + 2u] = d.firstIndex;
+  cmds[o * 5u + 3u] = uint(d.baseVertex);
+  cmds[o * 5u + 4u] = o;  /* baseInstance: per draw data below */
+
+  for (j = 0u; j < 25u; j++)
+    instOut[o * 25u + j] = instIn[i * 25u + j];
+}
+)
@@ -17,15 +17,42 @@
  */
 
 GK_STRINGIFY(
+\n#ifdef TRANSFORM_UBO\n
+/* per frame, shared by all draws */
+layout(std140) uniform CameraBlock {
+  mat4 VP;        /* Projection * View mtrix          */
+  mat4 V;         /* View matrix                      */
+};
+\n#else\n
+uniform mat4 VP;  /* Projection * View mtrix          */
+\n#ifdef INSTANCED\n
+uniform mat4 V;   /* View matrix                      */
+\n#endif\n
+\n#endif\n
+
+\n#ifdef INSTANCED\n
+/* per instance, streamed by instanced draws */
+layout(location = 9)  in mat4 INST_M;  /* Model matrix         */
+layout(location = 13) in mat3 INST_NM; /* World normal matrix  */
+\n#elif defined(TRANSFORM_UBO)\n
+/* per draw, range of transform ring buffer */
+layout(std140) uniform DrawBlock {
+  mat4 MVP;       /* Projection * View * Model matrix */
+  mat4 MV;        /* View * Model matrix              */
+  mat4 M;         /* Model matrix                     */
+  mat3 NM;        /* Normal matrix                    */
+  int  NMU;       /* Use normal matrix                */
+};
+\n#else\n
 uniform mat4 MVP; /* Projection * View * Model matrix */
 uniform mat4 MV;  /* View * Model matrix              */
 uniform mat4 NM;  /* Normal matrix                    */
 uniform int  NMU; /* Use normal matrix                */
-uniform mat4 VP;  /* Projection * View mtrix          */
 \n#ifdef POS_WS\n
 uniform mat4 M;   /* Model matrix                     */
 \n#endif\n
 uniform mat4 M;
+\n#endif\n
 \n#ifdef SHADOWMAP\n
 \n#ifndef SHAD_SPLIT\n
 uniform mat4 uShadMVP;
@@ -75,6 +102,14 @@ out vec3 vPosWS;
 void main() {
   vec4 pos4, norm4;
 
+\n#ifdef INSTANCED\n
+  mat4 M, MV, MVP;
+
+  M   = INST_M;
+  MV  = V  * INST_M;
+  MVP = VP * INST_M;
+\n#endif\n
+
   pos4  = vec4(POSITION, 1.0);
   norm4 = vec4(NORMAL,   0.0);
   vPos  = vec3(MV * pos4);
@@ -104,10 +139,18 @@ void main() {
   vPosMS = pos4;
 \n#endif\n
 
+\n#ifdef INSTANCED\n
+  vNormal = normalize(mat3(V) * (INST_NM * norm4.xyz));
+\n#else\n
   if (NMU == 1)
+\n#ifdef TRANSFORM_UBO\n
+    vNormal = normalize(NM * norm4.xyz);
+\n#else\n
     vNormal = normalize(vec3(NM * norm4));
+\n#endif\n
   else
     vNormal = normalize(vec3(MV * norm4));
+\n#endif\n
 
 \n#ifdef JOINT_COUNT\n
   gl_Position = VP * pos4;
@@ -89,6 +89,11 @@ gk_creatProgByName(char *name, void *userData) {
 
     /* TODO: create dynamic by platform */
     source[0] = "#version 410 \n";
+
+#ifdef GL_COMPUTE_SHADER
+    if (shaderTypes[i] == GL_COMPUTE_SHADER)
+      source[0] = "#version 430 \n";
+#endif
     source[1] = (char *)shaderSources[i];
 
     shader = calloc(1, sizeof(*shader));
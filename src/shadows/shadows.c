@@ -29,6 +29,7 @@
 
 #include "../shader/shader.h"
 #include "../state/gpu.h"
+#include "../render/realtime/packet.h"
 
 #include "builtin/basic.h"
 #include "builtin/csm.h"
@@ -62,6 +63,8 @@ gkSetShadowTechn(GkShadowTechnType techn) {
     default:
       break;
   }
+
+  gkInvalidatePipelines();
 }
 
 GK_EXPORT
@@ -74,6 +77,7 @@ GK_EXPORT
 void
 gkSetShadowSplit(uint32_t splitCount) {
   gk__shadSplitCount = splitCount;
+  gkInvalidatePipelines();
 }
 
 GK_EXPORT
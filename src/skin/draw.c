@@ -61,11 +61,11 @@ gkDrawBones(GkScene * __restrict scene) {
   GkContext        *ctx;
   GkSceneImpl      *sceneImpl;
   GkSkin           *skin;
-  FListItem        *item;
-  GkNode           *node;
+  GkNodeCompList   *skinned;
   GkControllerInst *ctlrInst;
   GkGeometryInst   *geomInst;
   GkPipeline       *prog;
+  uint32_t          i;
 
   ctx  = gkContextOf(scene);
   prog = gk_prog_drawbone();
@@ -83,22 +83,20 @@ gkDrawBones(GkScene * __restrict scene) {
   glBindBuffer(GL_UNIFORM_BUFFER, gk__bone_ubo);
 
   sceneImpl = (GkSceneImpl *)scene;
-  if ((item = sceneImpl->instSkins)) {
-    do {
-      node     = item->data;
-      ctlrInst = node->controller;
-
-      if (ctlrInst->ctlr
-          && (skin = (GkSkin *)ctlrInst->ctlr)
-          && (geomInst = skin->base.source)) {
-        /* TODO: optimize this */
-        glBufferSubData(GL_UNIFORM_BUFFER,
-                        0,
-                        sizeof(mat4) * skin->nJoints,
-                        geomInst->jointsToDraw);
-        glDrawArrays(GL_LINE_STRIP, 0, (GLint)skin->nJoints);
-      }
-    } while ((item = item->next));
+  skinned = &sceneImpl->comps[GK_NODE_COMP_SKINNED];
+  for (i = 0; i < skinned->count; i++) {
+    ctlrInst = skinned->items[i].item;
+
+    if (ctlrInst->ctlr
+        && (skin = (GkSkin *)ctlrInst->ctlr)
+        && (geomInst = skin->base.source)) {
+      /* TODO: optimize this */
+      glBufferSubData(GL_UNIFORM_BUFFER,
+                      0,
+                      sizeof(mat4) * skin->nJoints,
+                      geomInst->jointsToDraw);
+      glDrawArrays(GL_LINE_STRIP, 0, (GLint)skin->nJoints);
+    }
   }
 
   gkPopState(ctx);
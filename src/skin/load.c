@@ -121,11 +121,8 @@ void
 gkMakeInstanceSkin(GkScene          * __restrict scene,
                    GkNode           * __restrict node,
                    GkControllerInst * __restrict ctlrInst) {
-  GkSceneImpl *sceneImpl;
-
-  sceneImpl        = (GkSceneImpl *)scene;
   ctlrInst->next   = node->controller;
   node->controller = ctlrInst;
 
-  flist_sp_insert(&sceneImpl->instSkins, node);
+  gkNodeCompAdd(scene, node, GK_NODE_COMP_SKINNED, ctlrInst);
 }
@@ -21,6 +21,7 @@
 #include "../include/gk/scene.h"
 #include "../include/gk/geom-types.h"
 #include "types/impl_transform.h"
+#include "default/transform.h"
 
 #include <ds/forward-list.h>
 #include <string.h>
@@ -31,18 +32,21 @@ gkCacheTransformsFor(GkScene  * __restrict scene,
                      GkCamera * __restrict cam) {
   GkSceneImpl  *sceneImpl;
   GkCameraImpl *camImpl;
-  FList        *transfCacheSlots;
 
   if (!cam)
     return;
 
-  sceneImpl        = (GkSceneImpl *)scene;
-  camImpl          = (GkCameraImpl *)cam;
-  transfCacheSlots = sceneImpl->transfCacheSlots;
+  sceneImpl = (GkSceneImpl *)scene;
+  camImpl   = (GkCameraImpl *)cam;
+
+  if (!(camImpl->transfSlot & (1 << 30)))
+    return;
 
-  flist_append(transfCacheSlots, cam);
+  flist_append(sceneImpl->transfCacheSlots, cam);
 
-  camImpl->transfSlot = flist_indexof(transfCacheSlots, cam);
+  /* final transforms live in camera's own pool which is indexed by
+     transform id, so slots of other cameras never move */
+  camImpl->transfSlot = 0;
 }
 
 GK_EXPORT
@@ -51,14 +55,41 @@ gkRemoveTransformCacheFor(GkScene  * __restrict scene,
                           GkCamera * __restrict cam) {
   GkSceneImpl  *sceneImpl;
   GkCameraImpl *camImpl;
-  FList        *transfCacheSlots;
 
   sceneImpl           = (GkSceneImpl *)scene;
   camImpl             = (GkCameraImpl *)cam;
-  transfCacheSlots    = sceneImpl->transfCacheSlots;
   camImpl->transfSlot = (1 << 30);
 
-  flist_remove_by(transfCacheSlots, cam);
+  flist_remove_by(sceneImpl->transfCacheSlots, cam);
+  gkFreeFinalTransforms(camImpl);
+}
+
+/* final transform slots of a reused id belong to the freed transform */
+static
+_gk_hide
+void
+gkResetFinalTransforms(GkSceneImpl * __restrict sceneImpl,
+                       uint32_t                 id) {
+  GkCameraImpl     *camImpl;
+  GkFinalTransform *ftr;
+  FListItem        *camItem;
+  uint32_t          ci;
+
+  ci      = id >> GK_FTR_CHUNK_SHIFT;
+  camItem = sceneImpl->transfCacheSlots->first;
+
+  while (camItem) {
+    camImpl = camItem->data;
+
+    if (ci < camImpl->ftrChunkCount && camImpl->ftrChunks[ci]) {
+      ftr             = &camImpl->ftrChunks[ci][id & (GK_FTR_CHUNK_SIZE - 1)];
+      ftr->trVersion  = UINT32_MAX;
+      ftr->camVersion = UINT32_MAX;
+      ftr->hasView    = false;
+    }
+
+    camItem = camItem->next;
+  }
 }
 
 GK_EXPORT
@@ -66,16 +97,21 @@ GkTransform*
 gkAllocTransform(GkScene * __restrict scene) {
   GkSceneImpl     *sceneImpl;
   GkTransformImpl *trans;
-  uint32_t         slotCount;
 
   sceneImpl = (GkSceneImpl *)scene;
-  slotCount = (uint32_t)sceneImpl->transfCacheSlots->count;
   trans     = calloc(1, sizeof(*trans));
-  if (slotCount > 0) {
-    trans->ftr  = calloc(1, sizeof(GkFinalTransform *) * slotCount);
-    trans->ftrc = slotCount;
+
+  /* reuse ids so that per camera pools stay as big as live transforms */
+  if (sceneImpl->freeTransfCount > 0) {
+    trans->id = sceneImpl->freeTransfIds[--sceneImpl->freeTransfCount];
+    gkResetFinalTransforms(sceneImpl, trans->id);
+  } else {
+    trans->id = ++sceneImpl->lastTransfId;
   }
 
+  trans->pub.local = trans->ownLocal;
+  trans->pub.world = trans->ownWorld;
+
   glm_mat4_copy(GLM_MAT4_IDENTITY, trans->pub.local);
   glm_mat4_copy(GLM_MAT4_IDENTITY, trans->pub.world);
 
@@ -86,120 +122,371 @@ gkAllocTransform(GkScene * __restrict scene) {
 
 GK_EXPORT
 void
-gkResizeTransform(GkScene         * __restrict scene,
-                  GkTransformImpl * __restrict trans) {
-  GkSceneImpl *sceneImpl;
-  uint32_t     slotCount;
+gkFreeTransform(GkScene     * __restrict scene,
+                GkTransform * __restrict trans) {
+  GkSceneImpl     *sceneImpl;
+  GkTransformItem *item, *next;
+  uint32_t         id;
 
-  sceneImpl = (GkSceneImpl *)scene;
-  slotCount = (uint32_t)sceneImpl->transfCacheSlots->count;
-  if (trans->ftrc == slotCount)
+  if (trans == gk_def_idmat() || trans == scene->trans)
     return;
 
-  if (slotCount == 0) {
-    if (trans->ftrc != 0) {
-      free(trans->ftr);
-      trans->ftrc = 0;
+  sceneImpl = (GkSceneImpl *)scene;
+
+  gkTransformStoreRemove(scene, trans);
+
+  if ((id = ((GkTransformImpl *)trans)->id) != 0) {
+    if (sceneImpl->freeTransfCount == sceneImpl->freeTransfSize) {
+      sceneImpl->freeTransfSize = sceneImpl->freeTransfSize
+                                  ? sceneImpl->freeTransfSize * 2 : 64;
+      sceneImpl->freeTransfIds  = realloc(sceneImpl->freeTransfIds,
+                                          sizeof(uint32_t)
+                                          * sceneImpl->freeTransfSize);
+    }
+
+    sceneImpl->freeTransfIds[sceneImpl->freeTransfCount++] = id;
+  }
+
+  item = trans->item;
+  while (item) {
+    next = item->next;
+    free(item);
+    item = next;
+  }
+
+  free(((GkTransformImpl *)trans)->steps);
+  free(trans);
+}
+
+GkFinalTransform*
+gkFinalTransformAlloc(GkCameraImpl * __restrict camImpl,
+                      uint32_t                  id) {
+  GkFinalTransform *chunk;
+  uint32_t          ci, count, i;
+
+  ci = id >> GK_FTR_CHUNK_SHIFT;
+
+  if (ci >= camImpl->ftrChunkCount) {
+    count = camImpl->ftrChunkCount * 2;
+    if (count <= ci)
+      count = ci + 1;
+
+    camImpl->ftrChunks = realloc(camImpl->ftrChunks,
+                                 sizeof(*camImpl->ftrChunks) * count);
+    memset(camImpl->ftrChunks + camImpl->ftrChunkCount,
+           0,
+           sizeof(*camImpl->ftrChunks) * (count - camImpl->ftrChunkCount));
+
+    camImpl->ftrChunkCount = count;
+  }
+
+  if (!(chunk = camImpl->ftrChunks[ci])) {
+    chunk = malloc(sizeof(*chunk) * GK_FTR_CHUNK_SIZE);
+    for (i = 0; i < GK_FTR_CHUNK_SIZE; i++) {
+      chunk[i].trVersion  = UINT32_MAX;
+      chunk[i].camVersion = UINT32_MAX;
+      chunk[i].hasView    = false;
     }
+
+    camImpl->ftrChunks[ci] = chunk;
+  }
+
+  return &chunk[id & (GK_FTR_CHUNK_SIZE - 1)];
+}
+
+void
+gkFreeFinalTransforms(GkCameraImpl * __restrict camImpl) {
+  uint32_t i;
+
+  for (i = 0; i < camImpl->ftrChunkCount; i++)
+    free(camImpl->ftrChunks[i]);
+
+  free(camImpl->ftrChunks);
+
+  camImpl->ftrChunks     = NULL;
+  camImpl->ftrChunkCount = 0;
+}
+
+/* shear along aroundAxis, rotateAxis is rotated toward it by angle */
+static
+void
+gkSkewMake(GkSkew * __restrict skew, mat4 dest) {
+  vec3  d1, d2, right, d1ortho;
+  float par, perp, theta, k;
+  int   i, j;
+
+  glm_mat4_identity(dest);
+
+  glm_vec3_normalize_to(skew->rotateAxis, d1);
+  glm_vec3_normalize_to(skew->aroundAxis, d2);
+
+  par   = glm_vec3_dot(d1, d2);
+  theta = acosf(glm_clamp(par, -1.0f, 1.0f));
+
+  /* degenerate, rotated axis would pass over aroundAxis */
+  if (skew->angle >= theta || skew->angle <= theta - (float)M_PI)
+    return;
+
+  glm_vec3_cross(d1, d2, right);
+  glm_vec3_normalize(right);
+  glm_vec3_cross(d2, right, d1ortho);
+
+  if ((perp = glm_vec3_dot(d1, d1ortho)) < FLT_EPSILON)
     return;
+
+  k = tanf((float)M_PI_2 - theta + skew->angle) - par / perp;
+
+  /* M = I + k * (d2 x d1ortho) */
+  for (i = 0; i < 3; i++) {
+    for (j = 0; j < 3; j++)
+      dest[i][j] += k * d2[j] * d1ortho[i];
+  }
+}
+
+static
+bool
+gkTransformItemMat(GkTransformItem * __restrict ti, mat4 dest) {
+  switch (ti->type) {
+    case GK_TRANS_MATRIX:
+      glm_mat4_copy(((GkMatrix *)ti)->value, dest);
+      break;
+    case GK_TRANS_LOOK_AT: {
+      GkLookAt *lookAt;
+      lookAt = (GkLookAt *)ti;
+
+      glm_lookat(lookAt->value[0],
+                 lookAt->value[1],
+                 lookAt->value[2],
+                 dest);
+
+      /* because this is view matrix */
+      glm_inv_tr(dest);
+      break;
+    }
+    case GK_TRANS_ROTATE: {
+      GkRotate *rotate;
+
+      rotate = (GkRotate *)ti;
+      glm_rotate_make(dest, rotate->value[3], rotate->value);
+      break;
+    }
+    case GK_TRANS_QUAT:
+      glm_quat_mat4(((GkQuaternion *)ti)->value, dest);
+      break;
+    case GK_TRANS_SCALE:
+      glm_scale_make(dest, ((GkScale *)ti)->value);
+      break;
+    case GK_TRANS_TRANSLATE:
+      glm_translate_make(dest, ((GkTranslate *)ti)->value);
+      break;
+    case GK_TRANS_SKEW:
+      gkSkewMake((GkSkew *)ti, dest);
+      break;
+    /* unitialized transform? */
+    default:
+      return false;
   }
 
-  if (!trans->ftr)
-    trans->ftr = calloc(1, sizeof(void *) * slotCount);
-  else
-    trans->ftr = realloc(trans->ftr, sizeof(void *) * slotCount);
+  return true;
+}
 
-  trans->ftrc = slotCount;
+static
+size_t
+gkTransformItemSize(GkTransformItem * __restrict ti) {
+  switch (ti->type) {
+    case GK_TRANS_MATRIX:    return sizeof(GkMatrix);
+    case GK_TRANS_LOOK_AT:   return sizeof(GkLookAt);
+    case GK_TRANS_ROTATE:    return sizeof(GkRotate);
+    case GK_TRANS_QUAT:      return sizeof(GkQuaternion);
+    case GK_TRANS_SCALE:     return sizeof(GkScale);
+    case GK_TRANS_TRANSLATE: return sizeof(GkTranslate);
+    case GK_TRANS_SKEW:      return sizeof(GkSkew);
+    default:                 return 0;
+  }
 }
 
+/* translate? (rotate | quat)? scale?, at least one animated item */
+static
+bool
+gkTransformIsTRS(GkTransformItem * __restrict ti) {
+  int order, o;
+
+  for (order = 0; ti; ti = ti->next, order = o) {
+    switch (ti->type) {
+      case GK_TRANS_TRANSLATE: o = 1; break;
+      case GK_TRANS_ROTATE:
+      case GK_TRANS_QUAT:      o = 2; break;
+      case GK_TRANS_SCALE:     o = 3; break;
+      default:                 return false;
+    }
+
+    if (o <= order)
+      return false;
+  }
+
+  return true;
+}
+
+/* fold runs of static items, animated ones are evaluated in each combine */
+static
 void
-gkTransformCombine(GkTransform * __restrict trans) {
-  mat4 mat = GLM_MAT4_IDENTITY_INIT;
+gkTransformCompile(GkTransformImpl * __restrict impl) {
   GkTransformItem *ti;
+  GkTransformStep *step;
+  mat4             tmp;
+  uint32_t         count;
+  bool             animated, folding;
+
+  count    = 0;
+  animated = false;
+  for (ti = impl->pub.item; ti; ti = ti->next) {
+    count++;
+    animated |= ti->animated;
+  }
 
-  if ((ti = trans->item)) {
-    mat4 tmp;
-
-    do {
-      switch (ti->type) {
-        case GK_TRANS_MATRIX: {
-          GkMatrix *matrix;
-          matrix = (GkMatrix *)ti;
-
-          glm_mat4_mul(mat, matrix->value, mat);
-          break;
-        }
-        case GK_TRANS_LOOK_AT: {
-          GkLookAt *lookAt;
-          lookAt = (GkLookAt *)ti;
-
-          glm_lookat(lookAt->value[0],
-                     lookAt->value[1],
-                     lookAt->value[2],
-                     tmp);
-
-          /* because this is view matrix */
-          glm_inv_tr(tmp);
-          glm_mat4_mul(mat, tmp, mat);
-          break;
-        }
-        case GK_TRANS_ROTATE: {
-          GkRotate *rotate;
-
-          rotate = (GkRotate *)ti;
-          glm_rotate_make(tmp, rotate->value[3], rotate->value);
-          glm_mat4_mul(mat, tmp, mat);
-          break;
-        }
-        case GK_TRANS_QUAT: {
-          GkQuaternion *quat;
-
-          quat = (GkQuaternion *)ti;
-          glm_quat_mat4(quat->value, tmp);
-          glm_mat4_mul(mat, tmp, mat);
-          break;
-        }
-        case GK_TRANS_SCALE: {
-          GkScale *scale;
-          scale = (GkScale *)ti;
-
-          glm_scale_make(tmp, scale->value);
-          glm_mat4_mul(mat, tmp, mat);
-          break;
-        }
-        case GK_TRANS_TRANSLATE: {
-          GkTranslate *translate;
-          translate = (GkTranslate *)ti;
-
-          glm_translate_make(tmp, translate->value);
-          glm_mat4_mul(mat, tmp, mat);
-          break;
-        }
-        case GK_TRANS_SKEW: {
-          /* TODO:
-             GkSkew *skew;
-             skew = (GkSkew *)ti;
-
-             glm_mat4_mul(mat, tmp, mat);
-           */
-          break;
-        }
-        /* unitialized transform? */
-        default:
-          goto ret;
-          break;
+  impl->stepCount = 0;
+  impl->compiled  = true;
+  impl->trs       = animated && gkTransformIsTRS(impl->pub.item);
+
+  if (impl->trs || count == 0)
+    return;
+
+  impl->steps = realloc(impl->steps, sizeof(*impl->steps) * count);
+  folding     = false;
+  step        = NULL;
+
+  for (ti = impl->pub.item; ti; ti = ti->next) {
+    if (ti->animated) {
+      step       = &impl->steps[impl->stepCount++];
+      step->item = ti;
+      folding    = false;
+      continue;
+    }
+
+    if (!gkTransformItemMat(ti, tmp))
+      break;
+
+    if (!folding) {
+      step       = &impl->steps[impl->stepCount++];
+      step->item = NULL;
+      folding    = true;
+      glm_mat4_copy(tmp, step->mat);
+    } else {
+      glm_mat4_mul(step->mat, tmp, step->mat);
+    }
+  }
+}
+
+/* T * R * S without matrix multiplications */
+static
+void
+gkTransformTRS(GkTransformItem * __restrict ti, mat4 dest) {
+  versor q;
+  vec3   t, s;
+
+  glm_vec3_zero(t);
+  glm_vec3_one(s);
+  glm_quat_identity(q);
+
+  for (; ti; ti = ti->next) {
+    switch (ti->type) {
+      case GK_TRANS_TRANSLATE:
+        glm_vec3_copy(((GkTranslate *)ti)->value, t);
+        break;
+      case GK_TRANS_ROTATE: {
+        GkRotate *rotate;
+
+        rotate = (GkRotate *)ti;
+        glm_quatv(q, rotate->value[3], rotate->value);
+        break;
       }
+      case GK_TRANS_QUAT:
+        glm_quat_copy(((GkQuaternion *)ti)->value, q);
+        break;
+      case GK_TRANS_SCALE:
+        glm_vec3_copy(((GkScale *)ti)->value, s);
+        break;
+      default: break;
+    }
+  }
+
+  glm_quat_mat4(q, dest);
+  glm_vec4_scale(dest[0], s[0], dest[0]);
+  glm_vec4_scale(dest[1], s[1], dest[1]);
+  glm_vec4_scale(dest[2], s[2], dest[2]);
+  glm_vec3_copy(t, dest[3]);
+}
+
+void
+gkTransformCombine(GkTransform * __restrict trans) {
+  GkTransformImpl *impl;
+  GkTransformStep *step;
+  mat4             mat, tmp;
+  uint32_t         i, count;
+
+  impl = (GkTransformImpl *)trans;
+
+  if (!impl->compiled)
+    gkTransformCompile(impl);
 
-      ti = ti->next;
-    } while (ti);
+  if (impl->trs) {
+    gkTransformTRS(trans->item, trans->local);
+    goto ret;
+  }
+
+  if ((count = impl->stepCount) == 0) {
+    glm_mat4_identity(trans->local);
+    goto ret;
+  }
+
+  step = impl->steps;
+  if (!step->item)
+    glm_mat4_copy(step->mat, mat);
+  else if (!gkTransformItemMat(step->item, mat))
+    glm_mat4_identity(mat);
+
+  for (i = 1; i < count; i++) {
+    step = &impl->steps[i];
+
+    if (!step->item) {
+      glm_mat4_mul(mat, step->mat, mat);
+    } else if (gkTransformItemMat(step->item, tmp)) {
+      glm_mat4_mul(mat, tmp, mat);
+    }
   }
 
-ret:
   glm_mat4_copy(mat, trans->local);
 
+ret:
   trans->flags |= GK_TRANSF_LOCAL_ISVALID;
 }
 
+GK_EXPORT
+void
+gkTransformItemsChanged(GkTransform * __restrict trans) {
+  ((GkTransformImpl *)trans)->compiled = false;
+  trans->flags &= ~GK_TRANSF_LOCAL_ISVALID;
+}
+
+void
+gkTransformMarkAnimated(GkTransform * __restrict trans, void *target) {
+  GkTransformItem *ti;
+  char            *p;
+
+  p = target;
+  for (ti = trans->item; ti; ti = ti->next) {
+    if (p < (char *)ti || p >= (char *)ti + gkTransformItemSize(ti))
+      continue;
+
+    if (!ti->animated) {
+      ti->animated = true;
+      ((GkTransformImpl *)trans)->compiled = false;
+    }
+
+    break;
+  }
+}
+
 GkPoint
 gk_project2d(GkRect rect, mat4 mvp, vec3 v) {
   vec4    pos4;
@@ -216,6 +503,22 @@ gk_project2d(GkRect rect, mat4 mvp, vec3 v) {
   return p;
 }
 
+/* inverse-transpose of upper 3x3, mv is affine so full 4x4 inverse is
+   not needed */
+static
+GK_INLINE
+void
+gkNormalMatrix(mat4 mv, mat4 dest) {
+  mat3 m3;
+
+  glm_mat4_pick3(mv, m3);
+  glm_mat3_inv(m3, m3);
+  glm_mat3_transpose(m3);
+
+  glm_mat4_identity(dest);
+  glm_mat4_ins3(m3, dest);
+}
+
 void
 gkUniformTransform(struct GkPipeline * __restrict prog,
                    GkTransform       * __restrict trans,
@@ -237,7 +540,7 @@ gkUniformTransform(struct GkPipeline * __restrict prog,
     return;
 
   pmvp = pmv = pnm = NULL;
-  if ((ftr = gkFinalTransform(trans, cam))) {
+  if ((ftr = gkValidFinalTransform(trans, cam))) {
     pmvp = ftr->mvp;
     pmv  = ftr->mv;
     pnm  = ftr->nm;
@@ -278,13 +581,15 @@ gkUniformTransform(struct GkPipeline * __restrict prog,
 
   /* Normal Matrix */
   if (hasNM) {
-    usenm = GK_FLG(trans->flags, GK_TRANSF_FMAT_NORMAT);
+    if (ftr)
+      usenm = GK_FLG(trans->flags, GK_TRANSF_FMAT_NORMAT);
+    else
+      usenm = !glm_uniscaled(trans->world);
+
     if (usenm) {
       if (hasMVP) {
-        if (!ftr) {
-          glm_mat4_inv(pmv, nm);
-          glm_mat4_transpose(nm);
-        }
+        if (!ftr)
+          gkNormalMatrix(pmv, nm);
 
         gkUniformMat4(prog->nmi, pnm);
       } else {
@@ -303,15 +608,20 @@ gkCalcFinalTransf(GkScene     * __restrict scene,
                   GkTransform * __restrict tr) {
   GkFinalTransform *ftr;
   GkCameraImpl     *camImpl;
+  GkTransformImpl  *trImpl;
 
   camImpl = (GkCameraImpl *)cam;
+  trImpl  = (GkTransformImpl *)tr;
   if (camImpl->transfSlot == (1 << 30))
     return;
 
-  if (!(ftr = gkFinalTransform(tr, cam))) {
-    if (!(ftr = gkSetFinalTransform(scene, tr, cam)))
-      return;
-  }
+  if (!(ftr = gkSetFinalTransform(scene, tr, cam)))
+    return;
+
+  /* already computed for this world and view, e.g. shared transform */
+  if (ftr->trVersion     == trImpl->version
+      && ftr->camVersion == camImpl->viewVersion)
+    return;
 
   glm_mat4_mul(cam->view, tr->world, ftr->mv);
   glm_mat4_mul(cam->proj, ftr->mv,   ftr->mvp);
@@ -320,11 +630,13 @@ gkCalcFinalTransf(GkScene     * __restrict scene,
     tr->flags &= ~GK_TRANSF_FMAT_NORMAT;
   } else {
     tr->flags |= GK_TRANSF_FMAT_NORMAT;
-
-    glm_mat4_inv(ftr->mv, ftr->nm);
-    glm_mat4_transpose(ftr->nm);
+    gkNormalMatrix(ftr->mv, ftr->nm);
   }
 
+  ftr->trVersion  = trImpl->version;
+  ftr->camVersion = camImpl->viewVersion;
+  ftr->hasView    = true;
+
   tr->flags |= (GK_TRANSF_FMAT | GK_TRANSF_FMAT_MV | GK_TRANSF_FMAT_MVP);
 }
 
@@ -339,12 +651,11 @@ gkCalcViewTransf(GkScene     * __restrict scene,
   if (camImpl->transfSlot == (1 << 30))
     return;
 
-  if (!(ftr = gkFinalTransform(tr, cam))) {
-    if (!(ftr = gkSetFinalTransform(scene, tr, cam)))
-      return;
-  }
+  if (!(ftr = gkSetFinalTransform(scene, tr, cam)))
+    return;
 
   glm_mat4_mul(cam->view, tr->world, ftr->mv);
+  ftr->hasView = true;
 
   tr->flags |= (GK_TRANSF_FMAT | GK_TRANSF_FMAT_MV);
 }
@@ -0,0 +1,227 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../common.h"
+#include "store.h"
+
+#include <string.h>
+
+static
+_gk_hide
+void
+gk__storeReserve(GkTransformStore * __restrict store, uint32_t count) {
+  if (count <= store->size)
+    return;
+
+  store->size = store->size ? store->size * 2 : 256;
+  if (store->size < count)
+    store->size = count;
+
+  store->nodes  = realloc(store->nodes,  store->size * sizeof(*store->nodes));
+  store->trans  = realloc(store->trans,  store->size * sizeof(*store->trans));
+  store->parent = realloc(store->parent, store->size * sizeof(*store->parent));
+  store->end    = realloc(store->end,    store->size * sizeof(*store->end));
+  store->local  = realloc(store->local,  store->size * sizeof(*store->local));
+  store->world  = realloc(store->world,  store->size * sizeof(*store->world));
+}
+
+static
+_gk_hide
+void
+gk__storeAppend(GkTransformStore * __restrict store,
+                GkNode           * __restrict node,
+                int32_t                       parent) {
+  GkTransform *tr;
+  uint32_t     idx;
+
+  for (; node; node = node->next) {
+    if (!(node->flags & GK_NODEF_NODE))
+      continue;
+
+    gk__storeReserve(store, store->count + 1);
+
+    idx = store->count++;
+    tr  = NULL;
+
+    /* same as gkPrepareNode(), nodes without transform use parent's one */
+    if ((node->flags & GK_NODEF_HAVE_TRANSFORM) && node->trans) {
+      tr = node->trans;
+      ((GkTransformImpl *)tr)->storeIndex = idx + 1;
+    } else if (!node->trans && node->parent) {
+      node->trans = node->parent->trans;
+    }
+
+    store->nodes[idx]  = node;
+    store->trans[idx]  = tr;
+    store->parent[idx] = parent;
+
+    gk__storeAppend(store, node->chld, (int32_t)idx);
+
+    store->end[idx] = store->count;
+  }
+}
+
+/* moves matrices back to transforms, store arrays may be reallocated */
+static
+_gk_hide
+void
+gk__storeRelease(GkTransformStore * __restrict store) {
+  GkTransformImpl *tr;
+  uint32_t         i;
+
+  for (i = 0; i < store->count; i++) {
+    if (!(tr = (GkTransformImpl *)store->trans[i]))
+      continue;
+
+    glm_mat4_copy(store->local[i], tr->ownLocal);
+    glm_mat4_copy(store->world[i], tr->ownWorld);
+
+    tr->pub.local  = tr->ownLocal;
+    tr->pub.world  = tr->ownWorld;
+    tr->storeIndex = 0;
+  }
+
+  store->count = 0;
+}
+
+void
+gkTransformStoreBuild(GkScene * __restrict scene) {
+  GkTransformStore *store;
+  GkTransform      *tr;
+  uint32_t          i;
+
+  store = &((GkSceneImpl *)scene)->transStore;
+  gk__storeRelease(store);
+
+  if (scene->rootNode) {
+    if (!scene->rootNode->trans)
+      scene->rootNode->trans = scene->trans;
+
+    gk__storeAppend(store, scene->rootNode, -1);
+  }
+
+  /* store owns matrices from now on, arrays don't move until next build */
+  for (i = 0; i < store->count; i++) {
+    if (!(tr = store->trans[i]))
+      continue;
+
+    glm_mat4_copy(tr->local, store->local[i]);
+    glm_mat4_copy(tr->world, store->world[i]);
+
+    tr->local = store->local[i];
+    tr->world = store->world[i];
+  }
+
+  store->dirty = false;
+}
+
+void
+gkTransformStoreRemove(GkScene     * __restrict scene,
+                       GkTransform * __restrict tr) {
+  GkTransformStore *store;
+  uint32_t          idx;
+
+  store = &((GkSceneImpl *)scene)->transStore;
+  if ((idx = ((GkTransformImpl *)tr)->storeIndex) == 0
+      || idx > store->count
+      || store->trans[idx - 1] != tr)
+    return;
+
+  store->trans[idx - 1]               = NULL;
+  ((GkTransformImpl *)tr)->storeIndex = 0;
+  store->dirty                        = true;
+}
+
+bool
+gkTransformStoreRange(GkScene  * __restrict scene,
+                      GkNode   * __restrict node,
+                      uint32_t * __restrict begin,
+                      uint32_t * __restrict end) {
+  GkTransformStore *store;
+  uint32_t          idx;
+
+  store = &((GkSceneImpl *)scene)->transStore;
+  if (store->dirty)
+    gkTransformStoreBuild(scene);
+
+  if (node == scene->rootNode) {
+    *begin = 0;
+    *end   = store->count;
+    return true;
+  }
+
+  if (!(node->flags & GK_NODEF_HAVE_TRANSFORM)
+      || !node->trans
+      || (idx = ((GkTransformImpl *)node->trans)->storeIndex) == 0
+      || idx > store->count
+      || store->nodes[idx - 1] != node)
+    return false;
+
+  *begin = idx - 1;
+  *end   = store->end[idx - 1];
+
+  return true;
+}
+
+void
+gkTransformStoreUpdate(GkScene * __restrict scene,
+                       uint32_t             begin,
+                       uint32_t             end) {
+  GkTransformStore *store;
+  GkTransform      *tr, **trans;
+  mat4             *local, *world;
+  vec4             *parentWorld;
+  int32_t          *parent;
+  uint32_t          i;
+
+  store  = &((GkSceneImpl *)scene)->transStore;
+  trans  = store->trans;
+  local  = store->local;
+  world  = store->world;
+  parent = store->parent;
+
+  /* transforms point to rows, parents come first so world matrices are
+     computed linearly in place */
+  for (i = begin; i < end; i++) {
+    parentWorld = parent[i] >= 0 ? world[parent[i]] : scene->trans->world;
+
+    if ((tr = trans[i])) {
+      /* recombines into local[i] */
+      if (!GK_FLG(tr->flags, GK_TRANSF_LOCAL_ISVALID))
+        gkTransformCombine(tr);
+
+      glm_mat4_mul(parentWorld, local[i], world[i]);
+    } else {
+      glm_mat4_copy(parentWorld, world[i]);
+    }
+  }
+}
+
+void
+gkTransformStoreDestroy(GkTransformStore * __restrict store) {
+  gk__storeRelease(store);
+
+  free(store->nodes);
+  free(store->trans);
+  free(store->parent);
+  free(store->end);
+  free(store->local);
+  free(store->world);
+
+  memset(store, 0, sizeof(*store));
+}
@@ -0,0 +1,65 @@
+/*
+ * This file is part of the gk project (https://github.com/recp/gk)
+ * Copyright (c) Recep Aslantas.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef transform_store_h
+#define transform_store_h
+
+#include "../../include/gk/gk.h"
+
+/*
+ flat transform hierarchy: nodes are stored in depth-first order so parents
+ come before children and each subtree is a contiguous range. Store owns local
+ and world matrices of its transforms, GkTransform points to their rows, so
+ world matrices are computed in one linear pass without copies.
+ */
+typedef struct GkTransformStore {
+  GkNode      **nodes;
+  GkTransform **trans;  /* own transform, NULL if node uses parent's one */
+  int32_t      *parent; /* -1 for top level nodes                        */
+  uint32_t     *end;    /* end of subtree (exclusive)                    */
+  mat4         *local;
+  mat4         *world;
+  uint32_t      count;
+  uint32_t      size;
+  bool          dirty;  /* hierarchy is changed, rebuild before use      */
+} GkTransformStore;
+
+void
+gkTransformStoreBuild(GkScene * __restrict scene);
+
+/* returns false if node is not in store as subtree root */
+bool
+gkTransformStoreRange(GkScene  * __restrict scene,
+                      GkNode   * __restrict node,
+                      uint32_t * __restrict begin,
+                      uint32_t * __restrict end);
+
+/* call before transform is freed, store must not point to it */
+void
+gkTransformStoreRemove(GkScene     * __restrict scene,
+                       GkTransform * __restrict tr);
+
+void
+gkTransformStoreUpdate(GkScene * __restrict scene,
+                       uint32_t             begin,
+                       uint32_t             end);
+
+void
+gkTransformStoreDestroy(GkTransformStore * __restrict store);
+
+#endif /* transform_store_h */
@@ -24,6 +24,7 @@
 #include "transp.h"
 #include "builtin/oit/weighted_blended.h"
 #include "builtin/phenomenological.h"
+#include "../render/realtime/packet.h"
 
 GkTranspTechnInitFunc   gk__transp_intfn = gkTranspWeightedBlendedInit;
 GkTranspTechnRenderFunc gk__transp_rnfn  = gkTranspWeightedBlended;
@@ -42,6 +43,8 @@ gkSetTranspTechn(GkTranspTechnType techn) {
     default:
       break;
   }
+
+  gkInvalidatePipelines();
 }
 
 GK_EXPORT
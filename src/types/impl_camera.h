@@ -23,10 +23,18 @@
 
 #include <stdint.h>
 
+#define GK_FTR_CHUNK_SHIFT 8
+#define GK_FTR_CHUNK_SIZE  (1u << GK_FTR_CHUNK_SHIFT)
+
+struct GkFinalTransform;
+
 typedef struct GkCameraImpl {
-  GkCamera  pub;
-  uint32_t  transfSlot;
-  float     lastZoomDist;
+  GkCamera                  pub;
+  uint32_t                  transfSlot;
+  float                     lastZoomDist;
+  uint32_t                  viewVersion; /* increased when view changes   */
+  struct GkFinalTransform **ftrChunks;   /* indexed by transform id       */
+  uint32_t                  ftrChunkCount;
 } GkCameraImpl;
 
 #endif /* impl_camera_h */
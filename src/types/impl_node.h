@@ -20,12 +20,25 @@
 #define impl_node_h
 
 #include "../../include/gk/gk.h"
+#include "../node/components.h"
+
+typedef struct GkNodeImpl {
+  GkNode             pub;
+  struct GkNodePage *page;
+  struct GkNodeImpl *nextFree;
+  uint32_t           liveIndex; /* index in scene's live node array */
+  uint32_t           comp[GK_NODE_COMP_COUNT]; /* index + 1, or 0   */
+} GkNodeImpl;
 
 typedef struct GkNodePage {
+  struct GkNodePage *prev;
   struct GkNodePage *next;
+  struct GkNodePage *prevAvail; /* pages which have free slots */
+  struct GkNodePage *nextAvail;
+  GkNodeImpl        *freeList;
   uint32_t           size;
   uint32_t           count;
-  GkNode             nodes[];
+  GkNodeImpl         nodes[];
 } GkNodePage;
 
 #endif /* impl_node_h */
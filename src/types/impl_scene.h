@@ -23,6 +23,10 @@
 #include "../../include/gk/node.h"
 #include "../../include/gk/animation.h"
 #include "impl_node.h"
+#include "../culling/bvh.h"
+#include "../culling/box_soa.h"
+#include "../transform/store.h"
+#include "../../include/gk/occlusion.h"
 
 #include <ds/forward-list.h>
 #include <tm/tm.h>
@@ -35,14 +39,35 @@ typedef struct GkSceneImpl {
   void              *transp;
   struct GkPass     *overridePass;     /* override all passes    */
   struct GkMaterial *overrideMaterial; /* override all materials */
+  uint32_t           instanceCount;    /* > 0 while drawing a batch */
+  uint32_t           multiDrawCount;   /* > 0 while drawing indirect */
+  size_t             multiDrawOffset;  /* in GL_DRAW_INDIRECT_BUFFER */
+  void              *gpuCull;
+  uint32_t           gpuCullGen;       /* packets culled on GPU, 0: none */
+  bool               gpuCullDirty;     /* a culled packet is changed */
   FList             *transfCacheSlots;
+  uint32_t           lastTransfId;     /* ids of transforms start from 1 */
+  uint32_t          *freeTransfIds;    /* ids of freed transforms */
+  uint32_t           freeTransfCount;
+  uint32_t           freeTransfSize;
 
-  GkNodePage        *nodePages;
   GkNodePage        *lastPage;
+  GkNodePage        *availPages;
+  GkNode           **liveNodes;
+  uint32_t           liveCount;
+  uint32_t           liveSize;
+  GkBVH              bvh;
+  GkBoxSoA           cullBoxes;
+  GkTransformStore   transStore;
+  GkNode           **dirtyNodes;
+  uint32_t           dirtyCount;
+  uint32_t           dirtySize;
+  void              *occlusion;
+  GkOcclusionMode    occlusionMode;
+  uint32_t           frame;
   FListItem         *anims;
 
-  FListItem         *instSkins;
-  FListItem         *instMorphs;
+  GkNodeCompList     comps[GK_NODE_COMP_COUNT];
   GkPipeline        *clearPipeline;
   GkRenderAfterClearFunc onClear;
   void              * onClearObj;
@@ -52,7 +77,8 @@ typedef struct GkSceneImpl {
   GkRenderPathFn     lightIterFunc;
   GkRenderPathType   rpath;
   int32_t            internalFormat;
-  size_t             centercount;
+  uint32_t           viewHiddenLayers; /* hiddenLayers at last gkApplyView */
+  uint32_t           skinHiddenLayers; /* hiddenLayers at last skin update */
   float              backingScale;
   bool               transpPass;
 } GkSceneImpl;
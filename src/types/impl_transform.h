@@ -31,13 +31,29 @@ typedef struct GkFinalTransform {
   mat4     mvp;  /* model view projection matrix */
   mat4     mv;   /* model view matrix            */
   mat4     nm;   /* normal matrix                */
+  uint32_t trVersion;  /* world version which mvp, nm computed for */
+  uint32_t camVersion; /* camera view version which mvp, nm computed for */
+  bool     hasView;    /* mv is computed at least once                */
 } GkFinalTransform;
 
+/* compiled item chain, item is NULL for folded static items */
+typedef struct GkTransformStep {
+  mat4             mat;
+  GkTransformItem *item;
+} GkTransformStep;
+
 typedef struct GkTransformImpl {
   GkTransform        pub;
+  mat4               ownLocal;   /* used while not in flat transform store */
+  mat4               ownWorld;
   uint32_t           refc;
-  uint32_t           ftrc;
-  GkFinalTransform **ftr;    /* cached transform[s] and infos per camera     */
+  uint32_t           id;         /* slot in cameras' final transform pools */
+  uint32_t           storeIndex; /* index + 1 in flat transform store, or 0 */
+  uint32_t           version;    /* increased when world matrix changes      */
+  GkTransformStep   *steps;
+  uint32_t           stepCount;
+  bool               compiled;
+  bool               trs;        /* items are translate, rotate, scale only */
 } GkTransformImpl;
 
 void
@@ -54,25 +70,52 @@ void
 gkCalcViewTransf(struct GkScene * __restrict scene,
                  GkCamera       * __restrict cam,
                  GkTransform    * __restrict tr);
-GK_EXPORT
+/* returns pool entry of transform for camera, allocates chunk if needed */
+GkFinalTransform*
+gkFinalTransformAlloc(GkCameraImpl * __restrict camImpl,
+                      uint32_t                  id);
+
 void
-gkResizeTransform(struct GkScene  * __restrict scene,
-                  GkTransformImpl * __restrict trans);
+gkFreeFinalTransforms(GkCameraImpl * __restrict camImpl);
 
 GK_INLINE
 GkFinalTransform*
 gkFinalTransform(GkTransform * __restrict transf,
                  GkCamera    * __restrict cam) {
-  GkTransformImpl *transfImpl;
-  GkCameraImpl    *camImpl;
+  GkFinalTransform *ftr;
+  GkCameraImpl     *camImpl;
+  uint32_t          id, chunk;
+
+  id      = ((GkTransformImpl *)transf)->id;
+  camImpl = (GkCameraImpl *)cam;
+  chunk   = id >> GK_FTR_CHUNK_SHIFT;
+
+  if (camImpl->transfSlot & (1 << 30)
+      || id == 0
+      || chunk >= camImpl->ftrChunkCount
+      || !camImpl->ftrChunks[chunk])
+    return NULL;
+
+  ftr = &camImpl->ftrChunks[chunk][id & (GK_FTR_CHUNK_SIZE - 1)];
+  if (!ftr->hasView)
+    return NULL;
+
+  return ftr;
+}
 
-  transfImpl = (GkTransformImpl *)transf;
-  camImpl    = (GkCameraImpl *)cam;
+/* final transform which is up to date for current world and view */
+GK_INLINE
+GkFinalTransform*
+gkValidFinalTransform(GkTransform * __restrict transf,
+                      GkCamera    * __restrict cam) {
+  GkFinalTransform *ftr;
 
-  if (camImpl->transfSlot & (1 << 30) || !transfImpl->ftr)
+  if (!(ftr = gkFinalTransform(transf, cam))
+      || ftr->trVersion  != ((GkTransformImpl *)transf)->version
+      || ftr->camVersion != ((GkCameraImpl *)cam)->viewVersion)
     return NULL;
 
-  return transfImpl->ftr[camImpl->transfSlot];
+  return ftr;
 }
 
 GK_INLINE
@@ -80,23 +123,15 @@ GkFinalTransform*
 gkSetFinalTransform(struct GkScene * __restrict scene,
                     GkTransform    * __restrict transf,
                     GkCamera       * __restrict cam) {
-  GkTransformImpl  *transfImpl;
-  GkCameraImpl     *camImpl;
-  GkFinalTransform *ftr;
-  GkSceneImpl      *sceneImpl;
-
-  sceneImpl  = (GkSceneImpl *)scene;
-  transfImpl = (GkTransformImpl *)transf;
-  camImpl    = (GkCameraImpl *)cam;
+  GkCameraImpl *camImpl;
+  uint32_t      id;
 
-  gkResizeTransform(scene, transfImpl);
-  if (sceneImpl->transfCacheSlots->count == 0)
+  camImpl = (GkCameraImpl *)cam;
+  if (camImpl->transfSlot & (1 << 30)
+      || (id = ((GkTransformImpl *)transf)->id) == 0)
     return NULL;
 
-  if (!(ftr = transfImpl->ftr[camImpl->transfSlot]))
-    transfImpl->ftr[camImpl->transfSlot] = ftr = malloc(sizeof(*ftr));
-
-  return ftr;
+  return gkFinalTransformAlloc(camImpl, id);
 }
 
 #endif /* impl_transform_h */